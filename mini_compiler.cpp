@@ -9,6 +9,8 @@ Lab 05: Left Recursion Elimination (direct + indirect)
 Lab 06 & 07: FIRST and FOLLOW
 Lab 08: LL(1) Parsing Table
 Lab 09: Predictive Parser for expression grammar + input string (e.g., id+id*id)
+Lab 10: SLR(1) / LALR(1) table construction and shift-reduce parser
+Tuning: incremental FIRST/FOLLOW/LL(1) table updates while editing a grammar
 
 How to use:
 - Paste into CodeBlocks -> Build & Run
@@ -17,6 +19,10 @@ How to use:
 */
 
 #include <bits/stdc++.h>
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MC_X86_SIMD 1
+#include <immintrin.h>
+#endif
 using namespace std;
 
 static const string EPS = "eps";
@@ -40,16 +46,6 @@ static inline bool isTerminalSymbol(const string &sym) {
     return true;
 }
 
-static string joinSymbols(const vector<string> &rhs) {
-    if (rhs.empty()) return EPS;
-    string out;
-    for (size_t i = 0; i < rhs.size(); i++) {
-        if (i) out += " ";
-        out += rhs[i];
-    }
-    return out;
-}
-
 // Tokenize a grammar RHS segment (no '|' or '->' inside).
 // Supports: E, E', id, +, *, (, ), etc. Epsilon accepted as: eps / epsilon / ε / @
 static vector<string> tokenizeGrammarSegment(const string &segRaw) {
@@ -98,67 +94,273 @@ static vector<string> tokenizeGrammarSegment(const string &segRaw) {
     return tokens;
 }
 
+// ----------------------------- Phase Statistics -----------------------------
+// Counters and wall time per pipeline phase, reported as JSON by --stats. A phase
+// reads the on/off flag once, on entry; inside the phase counts go to a local tally
+// that is merged (atomically, phases may run on pool threads) on exit. Building with
+// -DMINI_COMPILER_NO_STATS turns every hook into an empty inline call.
+enum class Phase {
+    RemoveComments, TokenizeC, LeftFactor, LeftRecursion,
+    FIRST, FOLLOW, ParseTable, PredictiveParse, LRTable, GrammarCache, IncrementalEdit, COUNT
+};
+
+enum StatKey : uint8_t {
+    STAT_BYTES, STAT_TOKENS, STAT_STEPS, STAT_PRODUCTIONS,
+    STAT_ITERATIONS, STAT_INSERTIONS, STAT_CONFLICTS, STAT_STATES, STAT_HITS, STAT_MISSES, STAT_COUNT
+};
+
+static constexpr size_t NUM_PHASES = (size_t)Phase::COUNT;
+static const char *const PHASE_NAMES[NUM_PHASES] = {
+    "removeCComments", "tokenizeC", "leftFactor", "eliminateLeftRecursion",
+    "computeFIRST", "computeFOLLOW", "buildParseTable", "predictiveParse", "buildLRTable", "grammarCache",
+    "incrementalEdit"};
+static const char *const STAT_NAMES[STAT_COUNT] = {
+    "bytes", "tokens", "steps", "productions_created", "iterations", "insertions", "conflicts", "states", "hits", "misses"};
+// Counters each phase reports (bit k = StatKey k), so zeros that matter still show.
+static const uint16_t PHASE_KEYS[NUM_PHASES] = {
+    1 << STAT_BYTES,
+    1 << STAT_BYTES | 1 << STAT_TOKENS,
+    1 << STAT_STEPS,
+    1 << STAT_STEPS | 1 << STAT_PRODUCTIONS,
+    1 << STAT_ITERATIONS | 1 << STAT_INSERTIONS,
+    1 << STAT_ITERATIONS | 1 << STAT_INSERTIONS,
+    1 << STAT_CONFLICTS,
+    1 << STAT_STEPS | 1 << STAT_TOKENS,
+    1 << STAT_STATES | 1 << STAT_ITERATIONS | 1 << STAT_CONFLICTS,
+    1 << STAT_HITS | 1 << STAT_MISSES | 1 << STAT_BYTES,
+    1 << STAT_STEPS | 1 << STAT_ITERATIONS | 1 << STAT_CONFLICTS};
+
+#ifndef MINI_COMPILER_NO_STATS
+struct PhaseRecord {
+    atomic<uint64_t> calls{0}, ns{0};
+    atomic<uint64_t> counters[STAT_COUNT]{};
+};
+
+static bool statsEnabled = false; // set once, before any work starts
+static PhaseRecord phaseRecords[NUM_PHASES];
+
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase p) : rec(statsEnabled ? &phaseRecords[(size_t)p] : nullptr) {
+        if (rec) t0 = chrono::steady_clock::now();
+    }
+    ~PhaseScope() {
+        if (!rec) return;
+        auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+        rec->calls.fetch_add(1, memory_order_relaxed);
+        rec->ns.fetch_add((uint64_t)ns, memory_order_relaxed);
+        for (size_t k = 0; k < STAT_COUNT; k++)
+            if (tally[k]) rec->counters[k].fetch_add(tally[k], memory_order_relaxed);
+    }
+    PhaseScope(const PhaseScope &) = delete;
+    PhaseScope &operator=(const PhaseScope &) = delete;
+
+    // Unconditional, so a hot loop pays one add and no branch.
+    void add(StatKey k, uint64_t n = 1) { tally[k] += n; }
+    // For counts that cost something to work out: only compute them when true.
+    bool active() const { return rec != nullptr; }
+
+private:
+    PhaseRecord *rec;
+    chrono::steady_clock::time_point t0;
+    uint64_t tally[STAT_COUNT] = {};
+};
+
+// A counter bumped outside any scope of its own phase (e.g. per helper call).
+static inline void statsAdd(Phase p, StatKey k, uint64_t n) {
+    if (statsEnabled) phaseRecords[(size_t)p].counters[k].fetch_add(n, memory_order_relaxed);
+}
+#else
+class PhaseScope {
+public:
+    explicit PhaseScope(Phase) {}
+    void add(StatKey, uint64_t = 1) {}
+    bool active() const { return false; }
+};
+
+static inline void statsAdd(Phase, StatKey, uint64_t) {}
+#endif
+
+static void enableStats() {
+#ifndef MINI_COMPILER_NO_STATS
+    statsEnabled = true;
+#else
+    cerr << "Statistics were compiled out (MINI_COMPILER_NO_STATS); the report will be empty.\n";
+#endif
+}
+
+static void writeStatsJson(ostream &out) {
+#ifndef MINI_COMPILER_NO_STATS
+    out << "{\n  \"compiled_in\": true,\n  \"phases\": [";
+    for (size_t p = 0; p < NUM_PHASES; p++) {
+        const PhaseRecord &r = phaseRecords[p];
+        uint64_t calls = r.calls.load(), ns = r.ns.load();
+        out << (p ? ",\n" : "\n") << "    {\"phase\": \"" << PHASE_NAMES[p] << "\", \"calls\": " << calls
+            << ", \"total_ns\": " << ns << ", \"mean_ns\": " << (calls ? ns / calls : 0);
+        for (size_t k = 0; k < STAT_COUNT; k++)
+            if (PHASE_KEYS[p] >> k & 1) out << ", \"" << STAT_NAMES[k] << "\": " << r.counters[k].load();
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+#else
+    out << "{\n  \"compiled_in\": false,\n  \"phases\": []\n}\n";
+#endif
+}
+
+// ----------------------------- Symbol Table -----------------------------
+// Every grammar symbol (plus EPS and END_MARK) is interned once to a dense integer id;
+// the grammar algorithms work on ids and names are only looked up again for printing.
+typedef int Sym;
+static const Sym SYM_EPS = 0; // EPS
+static const Sym SYM_END = 1; // END_MARK
+
+struct SymbolTable {
+    deque<string> names;                 // deque: elements never move, so the keys below stay valid
+    unordered_map<string_view, Sym> ids;
+
+    SymbolTable() {
+        intern(EPS);
+        intern(END_MARK);
+    }
+    SymbolTable(const SymbolTable &o) : names(o.names) { reindex(); }
+    SymbolTable(SymbolTable &&) = default;
+    SymbolTable &operator=(const SymbolTable &o) {
+        if (this != &o) {
+            names = o.names;
+            reindex();
+        }
+        return *this;
+    }
+    SymbolTable &operator=(SymbolTable &&) = default;
+
+    Sym intern(string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        names.emplace_back(name);
+        Sym id = (Sym)names.size() - 1;
+        ids.emplace(string_view(names.back()), id);
+        return id;
+    }
+
+    // -1 if the name was never interned
+    Sym find(string_view name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? -1 : it->second;
+    }
+
+    const string &name(Sym s) const { return names[(size_t)s]; }
+    size_t size() const { return names.size(); }
+
+private:
+    void reindex() {
+        ids.clear();
+        for (size_t i = 0; i < names.size(); i++) ids.emplace(string_view(names[i]), (Sym)i);
+    }
+};
+
 // ----------------------------- Grammar Structure -----------------------------
 struct Grammar {
-    string start;
-    set<string> nonterminals;
-    set<string> terminals;
-    map<string, vector<vector<string>>> prod; // A -> list of RHS (each RHS is vector of symbols)
+    SymbolTable symtab;
+    Sym start = -1;
+    vector<Sym> nonterminals;         // kept sorted by name (print and processing order)
+    vector<Sym> terminals;            // sorted by name
+    vector<vector<vector<Sym>>> prod; // indexed by Sym: A -> list of RHS (each RHS is vector of symbols)
+    vector<char> ntFlag, termFlag;    // indexed by Sym
+
+    Sym intern(string_view name) {
+        Sym s = symtab.intern(name);
+        if ((size_t)s >= prod.size()) {
+            prod.resize(symtab.size());
+            ntFlag.resize(symtab.size(), 0);
+            termFlag.resize(symtab.size(), 0);
+        }
+        return s;
+    }
+
+    const string &name(Sym s) const { return symtab.name(s); }
+
+    bool isNonTerminal(Sym s) const {
+        return s >= 0 && (size_t)s < ntFlag.size() && ntFlag[(size_t)s];
+    }
 
-    bool isNonTerminal(const string &s) const {
-        return nonterminals.count(s) > 0;
+    bool isTerminal(Sym s) const {
+        return s >= 0 && (size_t)s < termFlag.size() && termFlag[(size_t)s];
     }
 
-    bool isTerminal(const string &s) const {
-        return terminals.count(s) > 0;
+    bool isNonTerminal(const string &s) const { return isNonTerminal(symtab.find(s)); }
+
+    bool nameLess(Sym a, Sym b) const { return name(a) < name(b); }
+
+    void addNonTerminal(Sym A) {
+        if (isNonTerminal(A)) return;
+        ntFlag[(size_t)A] = 1;
+        auto pos = lower_bound(nonterminals.begin(), nonterminals.end(), A,
+                               [&](Sym x, Sym y) { return nameLess(x, y); });
+        nonterminals.insert(pos, A);
     }
 
     void recomputeSymbols() {
+        fill(termFlag.begin(), termFlag.end(), 0);
         terminals.clear();
         // terminals = all RHS symbols that are not nonterminals and not EPS
-        for (auto &kv : prod) {
-            for (auto &rhs : kv.second) {
-                for (auto &sym : rhs) {
-                    if (sym == EPS) continue;
-                    if (!isNonTerminal(sym)) terminals.insert(sym);
+        for (Sym A : nonterminals) {
+            for (auto &rhs : prod[(size_t)A]) {
+                for (Sym sym : rhs) {
+                    if (sym == SYM_EPS || isNonTerminal(sym) || termFlag[(size_t)sym]) continue;
+                    termFlag[(size_t)sym] = 1;
+                    terminals.push_back(sym);
                 }
             }
         }
+        sort(terminals.begin(), terminals.end(), [&](Sym x, Sym y) { return nameLess(x, y); });
+    }
+
+    string rhsToString(const vector<Sym> &rhs) const {
+        if (rhs.empty()) return EPS;
+        string out;
+        for (size_t i = 0; i < rhs.size(); i++) {
+            if (i) out += " ";
+            out += name(rhs[i]);
+        }
+        return out;
     }
 
     void print() const {
         cout << "\n--- Grammar ---\n";
-        cout << "Start symbol: " << start << "\n";
-        for (auto &A : nonterminals) {
-            auto it = prod.find(A);
-            if (it == prod.end()) continue;
-            cout << A << " -> ";
-            const auto &alts = it->second;
+        cout << "Start symbol: " << (start >= 0 ? name(start) : string()) << "\n";
+        for (Sym A : nonterminals) {
+            cout << name(A) << " -> ";
+            const auto &alts = prod[(size_t)A];
             for (size_t i = 0; i < alts.size(); i++) {
                 if (i) cout << " | ";
-                cout << joinSymbols(alts[i]);
+                cout << rhsToString(alts[i]);
             }
             cout << "\n";
         }
         cout << "NonTerminals: ";
-        for (auto &x : nonterminals) cout << x << " ";
+        for (Sym x : nonterminals) cout << name(x) << " ";
         cout << "\nTerminals: ";
-        for (auto &x : terminals) cout << x << " ";
+        for (Sym x : terminals) cout << name(x) << " ";
         cout << "\n--------------\n";
     }
 };
 
-static string makeUniqueNonTerminal(const Grammar &g, const string &base) {
+static Sym makeUniqueNonTerminal(Grammar &g, Sym baseSym) {
     // Try base', base1, base2 ...
+    const string base = g.name(baseSym);
+    auto freeName = [&](const string &cand) { return !g.isNonTerminal(cand); };
     string cand = base + "'";
-    if (!g.nonterminals.count(cand)) return cand;
-    for (int k = 1; k <= 999; k++) {
-        cand = base + to_string(k);
-        if (!g.nonterminals.count(cand)) return cand;
-        cand = base + "'" + to_string(k);
-        if (!g.nonterminals.count(cand)) return cand;
+    if (!freeName(cand)) {
+        cand.clear();
+        for (int k = 1; k <= 999 && cand.empty(); k++) {
+            if (freeName(base + to_string(k))) cand = base + to_string(k);
+            else if (freeName(base + "'" + to_string(k))) cand = base + "'" + to_string(k);
+        }
+        if (cand.empty()) cand = base + "_NEW";
     }
-    return base + "_NEW";
+    Sym s = g.intern(cand);
+    g.addNonTerminal(s);
+    return s;
 }
 
 // Parse a single production line like:
@@ -183,8 +385,9 @@ static void addRuleLine(Grammar &g, const string &lineRaw) {
         return;
     }
 
-    g.nonterminals.insert(lhs);
-    if (g.start.empty()) g.start = lhs;
+    Sym A = g.intern(lhs);
+    g.addNonTerminal(A);
+    if (g.start < 0) g.start = A;
 
     // Split RHS by '|'
     vector<string> parts;
@@ -203,16 +406,104 @@ static void addRuleLine(Grammar &g, const string &lineRaw) {
 
     for (auto &p : parts) {
         auto tokens = tokenizeGrammarSegment(p);
-        // Normalize epsilon-only production
-        if (tokens.size() == 1 && tokens[0] == EPS) {
-            g.prod[lhs].push_back({EPS});
-        } else {
-            g.prod[lhs].push_back(tokens);
-        }
+        vector<Sym> rhs;
+        for (auto &t : tokens) rhs.push_back(g.intern(t));
+        g.prod[(size_t)A].push_back(rhs);
     }
 }
 
 // Read grammar from user
+struct GrammarLoadResult {
+    size_t lines = 0, rules = 0, productions = 0;
+    vector<string> errors; // "line N: ..."
+    double seconds = 0;
+};
+
+static string_view trimView(string_view s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == string_view::npos) return {};
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
+
+// Bulk form of addRuleLine for whole grammar files: the same syntax and symbols, but
+// parsed in one pass over the buffer with symbols interned straight from string
+// views, and nonterminals sorted once at the end rather than on every insert. Bad
+// lines are skipped and reported with their line numbers.
+static GrammarLoadResult loadGrammarText(string_view text, Grammar &g) {
+    GrammarLoadResult res;
+    auto t0 = chrono::steady_clock::now();
+    vector<Sym> added;
+    vector<Sym> rhs;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == string_view::npos) nl = text.size();
+        string_view line = trimView(text.substr(pos, nl - pos));
+        pos = nl + 1;
+        res.lines++;
+        if (line.empty()) continue;
+
+        size_t arrow = line.find("->"), arrowLen = 2;
+        if (arrow == string_view::npos) {
+            arrow = line.find("→");
+            arrowLen = strlen("→");
+        }
+        if (arrow == string_view::npos) {
+            res.errors.push_back("line " + to_string(res.lines) + ": missing ->");
+            continue;
+        }
+        string_view lhs = trimView(line.substr(0, arrow));
+        if (lhs.empty()) {
+            res.errors.push_back("line " + to_string(res.lines) + ": empty left-hand side");
+            continue;
+        }
+
+        Sym A = g.intern(lhs);
+        if (!g.isNonTerminal(A)) {
+            g.ntFlag[(size_t)A] = 1;
+            added.push_back(A);
+        }
+        if (g.start < 0) g.start = A;
+        res.rules++;
+
+        // alternatives, tokenized as in tokenizeGrammarSegment
+        string_view alts = line.substr(arrow + arrowLen);
+        while (true) {
+            size_t bar = alts.find('|');
+            string_view seg = alts.substr(0, bar);
+            rhs.clear();
+            for (size_t i = 0; i < seg.size();) {
+                char c = seg[i];
+                if (isspace((unsigned char)c)) {
+                    i++;
+                } else if (isIdentChar(c)) {
+                    size_t j = i;
+                    while (j < seg.size() && isIdentChar(seg[j])) j++;
+                    string_view t = seg.substr(i, j - i);
+                    rhs.push_back((t == "eps" || t == "epsilon") ? SYM_EPS : g.intern(t));
+                    i = j;
+                } else {
+                    rhs.push_back(g.intern(seg.substr(i, 1)));
+                    i++;
+                }
+            }
+            if (rhs.empty()) rhs.push_back(SYM_EPS);
+            g.prod[(size_t)A].push_back(rhs);
+            res.productions++;
+            if (bar == string_view::npos) break;
+            alts.remove_prefix(bar + 1);
+        }
+    }
+
+    g.nonterminals.insert(g.nonterminals.end(), added.begin(), added.end());
+    sort(g.nonterminals.begin(), g.nonterminals.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+    g.recomputeSymbols();
+    res.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return res;
+}
+
 static Grammar readGrammarFromUser() {
     Grammar g;
     cout << "\nEnter number of production lines: ";
@@ -251,124 +542,138 @@ static Grammar defaultLeftFactoringExample() {
 }
 
 // ----------------------------- Lab 04: Left Factoring -----------------------------
-static size_t commonPrefixLen(const vector<string> &a, const vector<string> &b) {
+static size_t commonPrefixLen(const vector<Sym> &a, const vector<Sym> &b) {
     size_t i = 0;
-    while (i < a.size() && i < b.size() && a[i] == b[i] && a[i] != EPS) i++;
+    while (i < a.size() && i < b.size() && a[i] == b[i] && a[i] != SYM_EPS) i++;
     return i;
 }
 
-static bool leftFactorOnce(Grammar &g) {
-    // For each nonterminal, find the longest common prefix among any pair of productions
-    for (const string &A : vector<string>(g.nonterminals.begin(), g.nonterminals.end())) {
-        auto &alts = g.prod[A];
-        if (alts.size() < 2) continue;
-
-        size_t bestLen = 0;
-        vector<string> bestPrefix;
-
-        // Find best prefix length
+// Factors A in one pass. Alternatives are grouped by their first symbol, which is
+// their branch in a prefix trie (groups keep first-appearance order). Each group of
+// two or more becomes prefix A', where prefix is the group's longest common prefix
+// and A' gets the remainders. Unfactored alternatives stay first, in their original
+// order, and the factored ones follow. The new nonterminals are then factored the
+// same way, depth first, which covers nested shared prefixes. Returns whether
+// anything changed.
+static bool leftFactorNonTerminal(Grammar &g, Sym A) {
+    bool changed = false;
+    vector<Sym> work{A};
+    unordered_map<Sym, size_t> groupOf;
+    while (!work.empty()) {
+        Sym X = work.back();
+        work.pop_back();
+        // moved out: makeUniqueNonTerminal may grow g.prod
+        vector<vector<Sym>> alts = move(g.prod[(size_t)X]);
+
+        vector<vector<size_t>> groups;
+        groupOf.clear();
         for (size_t i = 0; i < alts.size(); i++) {
-            for (size_t j = i + 1; j < alts.size(); j++) {
-                size_t len = commonPrefixLen(alts[i], alts[j]);
-                if (len > bestLen) {
-                    bestLen = len;
-                    bestPrefix.assign(alts[i].begin(), alts[i].begin() + (long long)len);
-                }
+            Sym first = alts[i].empty() ? SYM_EPS : alts[i][0];
+            if (first == SYM_EPS) {
+                groups.push_back({i});
+                continue;
             }
-        }
-        if (bestLen == 0) continue;
-
-        // Collect all productions that share this prefix
-        vector<vector<string>> group, rest;
-        for (auto &rhs : alts) {
-            bool ok = (rhs.size() >= bestLen);
-            for (size_t k = 0; ok && k < bestLen; k++) {
-                if (rhs[k] != bestPrefix[k]) ok = false;
+            auto it = groupOf.find(first);
+            if (it == groupOf.end()) {
+                groupOf.emplace(first, groups.size());
+                groups.push_back({i});
+            } else {
+                groups[it->second].push_back(i);
             }
-            if (ok) group.push_back(rhs);
-            else rest.push_back(rhs);
         }
-        if (group.size() < 2) continue;
-
-        // Create new nonterminal A'
-        string Aprime = makeUniqueNonTerminal(g, A);
-        g.nonterminals.insert(Aprime);
 
-        // New productions for A: prefix Aprime plus the rest productions
-        vector<vector<string>> newA = rest;
-        vector<string> newRhs = bestPrefix;
-        newRhs.push_back(Aprime);
-        newA.push_back(newRhs);
+        vector<vector<Sym>> kept, factored;
+        vector<Sym> created;
+        for (auto &grp : groups) {
+            if (grp.size() < 2) {
+                kept.push_back(move(alts[grp[0]]));
+                continue;
+            }
+            const vector<Sym> &lead = alts[grp[0]];
+            size_t len = lead.size();
+            for (size_t k = 1; k < grp.size(); k++) len = min(len, commonPrefixLen(lead, alts[grp[k]]));
+
+            Sym Xprime = makeUniqueNonTerminal(g, X);
+            vector<vector<Sym>> rems;
+            for (size_t i : grp) {
+                vector<Sym> rem(alts[i].begin() + (long long)len, alts[i].end());
+                if (rem.empty()) rem = {SYM_EPS};
+                rems.push_back(move(rem));
+            }
+            g.prod[(size_t)Xprime] = move(rems);
 
-        // Productions for Aprime are remainders
-        vector<vector<string>> newAprime;
-        for (auto &rhs : group) {
-            vector<string> rem(rhs.begin() + (long long)bestLen, rhs.end());
-            if (rem.empty()) rem = {EPS};
-            newAprime.push_back(rem);
+            vector<Sym> rhs(lead.begin(), lead.begin() + (long long)len);
+            rhs.push_back(Xprime);
+            factored.push_back(move(rhs));
+            created.push_back(Xprime);
         }
 
-        g.prod[A] = newA;
-        g.prod[Aprime] = newAprime;
-
-        g.recomputeSymbols();
-        return true; // did one factoring step
+        for (auto &rhs : factored) kept.push_back(move(rhs));
+        g.prod[(size_t)X] = move(kept);
+        if (!created.empty()) changed = true;
+        for (auto it = created.rbegin(); it != created.rend(); ++it) work.push_back(*it);
     }
-    return false;
+    return changed;
 }
 
 static void leftFactor(Grammar &g) {
-    while (leftFactorOnce(g)) {
-        // repeat until stable
-    }
+    PhaseScope stats(Phase::LeftFactor);
+    size_t ntsBefore = g.nonterminals.size();
+    bool changed = false;
+    for (Sym A : vector<Sym>(g.nonterminals)) changed |= leftFactorNonTerminal(g, A);
+    stats.add(STAT_STEPS, g.nonterminals.size() - ntsBefore); // one new nonterminal per factoring
+    if (changed) g.recomputeSymbols();
 }
 
 // ----------------------------- Lab 05: Left Recursion Elimination -----------------------------
-static void substituteAjIntoAi(Grammar &g, const string &Ai, const string &Aj) {
+static void substituteAjIntoAi(Grammar &g, Sym Ai, Sym Aj) {
     // Replace productions Ai -> Aj γ with Aj alternatives
-    vector<vector<string>> newAlts;
-    for (auto &rhs : g.prod[Ai]) {
+    vector<vector<Sym>> newAlts;
+    size_t created = 0;
+    for (auto &rhs : g.prod[(size_t)Ai]) {
         if (!rhs.empty() && rhs[0] == Aj) {
-            vector<string> gamma(rhs.begin() + 1, rhs.end());
-            for (auto &delta : g.prod[Aj]) {
-                vector<string> expanded;
-                if (!(delta.size() == 1 && delta[0] == EPS)) {
+            created += g.prod[(size_t)Aj].size();
+            for (auto &delta : g.prod[(size_t)Aj]) {
+                vector<Sym> expanded;
+                if (!(delta.size() == 1 && delta[0] == SYM_EPS)) {
                     expanded.insert(expanded.end(), delta.begin(), delta.end());
                 }
-                expanded.insert(expanded.end(), gamma.begin(), gamma.end());
-                if (expanded.empty()) expanded = {EPS};
+                expanded.insert(expanded.end(), rhs.begin() + 1, rhs.end());
+                if (expanded.empty()) expanded = {SYM_EPS};
                 newAlts.push_back(expanded);
             }
         } else {
             newAlts.push_back(rhs);
         }
     }
-    g.prod[Ai] = newAlts;
+    statsAdd(Phase::LeftRecursion, STAT_PRODUCTIONS, created);
+    statsAdd(Phase::LeftRecursion, STAT_STEPS, 1);
+    g.prod[(size_t)Ai] = newAlts;
 }
 
-static void eliminateImmediateLeftRecursion(Grammar &g, const string &A) {
-    vector<vector<string>> alpha; // A -> A alpha
-    vector<vector<string>> beta;  // A -> beta
+// Returns the new A' (-1 if A was not directly left-recursive).
+static Sym eliminateImmediateLeftRecursion(Grammar &g, Sym A) {
+    vector<vector<Sym>> alpha; // A -> A alpha
+    vector<vector<Sym>> beta;  // A -> beta
 
-    for (auto &rhs : g.prod[A]) {
+    for (auto &rhs : g.prod[(size_t)A]) {
         if (!rhs.empty() && rhs[0] == A) {
-            vector<string> tail(rhs.begin() + 1, rhs.end());
-            if (tail.empty()) tail = {EPS};
+            vector<Sym> tail(rhs.begin() + 1, rhs.end());
+            if (tail.empty()) tail = {SYM_EPS};
             alpha.push_back(tail);
         } else {
             beta.push_back(rhs);
         }
     }
-    if (alpha.empty()) return;
+    if (alpha.empty()) return -1;
 
-    string Aprime = makeUniqueNonTerminal(g, A);
-    g.nonterminals.insert(Aprime);
+    Sym Aprime = makeUniqueNonTerminal(g, A);
 
     // A -> beta Aprime
-    vector<vector<string>> newA;
+    vector<vector<Sym>> newA;
     for (auto &b : beta) {
-        vector<string> rhs = b;
-        if (!(rhs.size() == 1 && rhs[0] == EPS)) {
+        vector<Sym> rhs = b;
+        if (!(rhs.size() == 1 && rhs[0] == SYM_EPS)) {
             rhs.push_back(Aprime);
         } else {
             rhs = {Aprime}; // if beta was epsilon, just Aprime
@@ -377,10 +682,10 @@ static void eliminateImmediateLeftRecursion(Grammar &g, const string &A) {
     }
 
     // Aprime -> alpha Aprime | eps
-    vector<vector<string>> newAprime;
+    vector<vector<Sym>> newAprime;
     for (auto &a : alpha) {
-        vector<string> rhs = a;
-        if (rhs.size() == 1 && rhs[0] == EPS) {
+        vector<Sym> rhs = a;
+        if (rhs.size() == 1 && rhs[0] == SYM_EPS) {
             // A -> A eps is weird; treat as just Aprime -> Aprime, ignore; but keep safe:
             rhs = {Aprime};
         } else {
@@ -388,27 +693,28 @@ static void eliminateImmediateLeftRecursion(Grammar &g, const string &A) {
         }
         newAprime.push_back(rhs);
     }
-    newAprime.push_back({EPS});
+    newAprime.push_back({SYM_EPS});
 
-    g.prod[A] = newA;
-    g.prod[Aprime] = newAprime;
+    g.prod[(size_t)A] = newA;
+    g.prod[(size_t)Aprime] = newAprime;
+    return Aprime;
 }
 
 static void eliminateLeftRecursion(Grammar &g) {
+    PhaseScope stats(Phase::LeftRecursion);
     // Standard algorithm handles indirect left recursion by ordering nonterminals
-    vector<string> nts(g.nonterminals.begin(), g.nonterminals.end());
+    vector<Sym> nts = g.nonterminals;
 
     for (size_t i = 0; i < nts.size(); i++) {
-        string Ai = nts[i];
+        Sym Ai = nts[i];
         for (size_t j = 0; j < i; j++) {
-            string Aj = nts[j];
-            substituteAjIntoAi(g, Ai, Aj);
+            substituteAjIntoAi(g, Ai, nts[j]);
         }
         eliminateImmediateLeftRecursion(g, Ai);
 
         // If new nonterminals were added, update list
         if (g.nonterminals.size() != nts.size()) {
-            nts.assign(g.nonterminals.begin(), g.nonterminals.end());
+            nts = g.nonterminals;
             // Ensure i still points to same Ai (re-find)
             auto it = find(nts.begin(), nts.end(), Ai);
             if (it != nts.end()) i = (size_t)(it - nts.begin());
@@ -417,244 +723,798 @@ static void eliminateLeftRecursion(Grammar &g) {
     g.recomputeSymbols();
 }
 
+// Strongly connected components of a graph over grammar symbols (iterative Tarjan).
+// Returns the components in the order they complete, i.e. reverse topological.
+static vector<vector<Sym>> stronglyConnectedComponents(const vector<Sym> &nodes, const vector<vector<Sym>> &edges) {
+    vector<int> index(edges.size(), -1), low(edges.size(), 0);
+    vector<char> onStack(edges.size(), 0);
+    vector<Sym> stack;
+    vector<pair<Sym, size_t>> call; // (node, next edge)
+    vector<vector<Sym>> comps;
+    int counter = 0;
+
+    for (Sym root : nodes) {
+        if (index[(size_t)root] >= 0) continue;
+        call.push_back({root, 0});
+        while (!call.empty()) {
+            auto &[x, e] = call.back();
+            if (e == 0 && index[(size_t)x] < 0) {
+                index[(size_t)x] = low[(size_t)x] = counter++;
+                stack.push_back(x);
+                onStack[(size_t)x] = 1;
+            }
+            if (e < edges[(size_t)x].size()) {
+                Sym y = edges[(size_t)x][e++];
+                if (index[(size_t)y] < 0) call.push_back({y, 0});
+                else if (onStack[(size_t)y]) low[(size_t)x] = min(low[(size_t)x], index[(size_t)y]);
+                continue;
+            }
+            Sym done = x;
+            call.pop_back();
+            if (!call.empty()) {
+                Sym p = call.back().first;
+                low[(size_t)p] = min(low[(size_t)p], low[(size_t)done]);
+            }
+            if (low[(size_t)done] != index[(size_t)done]) continue;
+            comps.emplace_back();
+            while (true) {
+                Sym t = stack.back();
+                stack.pop_back();
+                onStack[(size_t)t] = 0;
+                comps.back().push_back(t);
+                if (t == done) break;
+            }
+        }
+    }
+    return comps;
+}
+
+struct LeftRecursionReport {
+    size_t productionsBefore = 0, productionsAfter = 0;
+    size_t components = 0;                   // SCCs of the left-corner graph
+    vector<vector<Sym>> recursiveComponents; // the ones that contain left recursion
+    size_t substitutions = 0, immediateEliminated = 0;
+    size_t unitLoopsDropped = 0;             // A -> A, which derives nothing new
+    bool budgetExceeded = false;
+    Sym stoppedAt = -1;
+    bool cyclic = false;                     // some A' still starts with A'
+    Sym cyclicAt = -1;
+};
+
+static size_t countProductions(const Grammar &g) {
+    size_t n = 0;
+    for (Sym A : g.nonterminals) n += g.prod[(size_t)A].size();
+    return n;
+}
+
+// Like eliminateLeftRecursion, but only where left recursion actually is. The
+// left-corner graph (A -> B when some A-production starts with B) is split into
+// strongly connected components, and the substitution ordering runs inside each
+// component that has a cycle or a self-loop; productions that start with a
+// nonterminal of another component cannot lead back and are left alone. If a
+// substitution would take the grammar past `budget` productions (0 = no limit) the
+// pass stops there. The grammar is still equivalent then, but may stay
+// left-recursive; the report says where it stopped.
+static LeftRecursionReport eliminateLeftRecursionScoped(Grammar &g, size_t budget) {
+    PhaseScope stats(Phase::LeftRecursion);
+    LeftRecursionReport rep;
+    rep.productionsBefore = countProductions(g);
+    size_t total = rep.productionsBefore;
+
+    vector<vector<Sym>> corner(g.symtab.size());
+    vector<char> selfLoop(g.symtab.size(), 0);
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            if (rhs.empty() || !g.isNonTerminal(rhs[0])) continue;
+            if (rhs[0] == A) selfLoop[(size_t)A] = 1;
+            corner[(size_t)A].push_back(rhs[0]);
+        }
+    }
+    vector<vector<Sym>> comps = stronglyConnectedComponents(g.nonterminals, corner);
+    rep.components = comps.size();
+    for (auto &c : comps) {
+        if (c.size() > 1 || selfLoop[(size_t)c[0]]) {
+            sort(c.begin(), c.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+            rep.recursiveComponents.push_back(c);
+        }
+    }
+    sort(rep.recursiveComponents.begin(), rep.recursiveComponents.end(),
+         [&](const vector<Sym> &x, const vector<Sym> &y) { return g.nameLess(x[0], y[0]); });
+
+    for (auto &comp : rep.recursiveComponents) {
+        for (size_t i = 0; i < comp.size() && !rep.budgetExceeded; i++) {
+            Sym Ai = comp[i];
+            for (size_t j = 0; j < i; j++) {
+                Sym Aj = comp[j];
+                size_t hits = 0;
+                for (auto &rhs : g.prod[(size_t)Ai]) hits += (!rhs.empty() && rhs[0] == Aj);
+                if (!hits) continue;
+                size_t grown = total - hits + hits * g.prod[(size_t)Aj].size();
+                if (budget && grown > budget) {
+                    rep.budgetExceeded = true;
+                    rep.stoppedAt = Ai;
+                    break;
+                }
+                substituteAjIntoAi(g, Ai, Aj);
+                total = grown;
+                rep.substitutions++;
+            }
+            if (rep.budgetExceeded) break;
+
+            // Ai -> Ai (eps tail) would become Ai' -> Ai'; the language does not need it.
+            auto &alts = g.prod[(size_t)Ai];
+            size_t before = alts.size();
+            alts.erase(remove_if(alts.begin(), alts.end(),
+                                 [&](const vector<Sym> &rhs) {
+                                     return !rhs.empty() && rhs[0] == Ai &&
+                                            all_of(rhs.begin() + 1, rhs.end(), [](Sym x) { return x == SYM_EPS; });
+                                 }),
+                       alts.end());
+            rep.unitLoopsDropped += before - alts.size();
+            total -= before - alts.size();
+
+            bool direct = false;
+            for (auto &rhs : alts) direct |= (!rhs.empty() && rhs[0] == Ai);
+            if (!direct) continue;
+            if (budget && total + 1 > budget) {
+                rep.budgetExceeded = true;
+                rep.stoppedAt = Ai;
+                break;
+            }
+            Sym Aprime = eliminateImmediateLeftRecursion(g, Ai);
+            total++; // Ai' -> eps
+            rep.immediateEliminated++;
+            if (Aprime >= 0 && !rep.cyclic) {
+                for (auto &rhs : g.prod[(size_t)Aprime]) {
+                    if (rhs.empty() || rhs[0] != Aprime) continue;
+                    rep.cyclic = true;
+                    rep.cyclicAt = Ai;
+                    break;
+                }
+            }
+        }
+        if (rep.budgetExceeded) break;
+    }
+
+    g.recomputeSymbols();
+    rep.productionsAfter = countProductions(g);
+    return rep;
+}
+
+static void printLeftRecursionReport(const Grammar &g, const LeftRecursionReport &rep) {
+    cout << "\n--- Left Recursion Report ---\n";
+    cout << "Left-corner components: " << rep.components << " (" << rep.recursiveComponents.size()
+         << " left-recursive)\n";
+    for (auto &c : rep.recursiveComponents) {
+        cout << "  {";
+        for (size_t i = 0; i < c.size(); i++) cout << (i ? " " : "") << g.name(c[i]);
+        cout << "}\n";
+    }
+    cout << "Substitutions: " << rep.substitutions << ", immediate eliminations: " << rep.immediateEliminated << "\n";
+    if (rep.unitLoopsDropped) cout << "Unit self-loops dropped: " << rep.unitLoopsDropped << "\n";
+    cout << "Productions: " << rep.productionsBefore << " -> " << rep.productionsAfter << "\n";
+    if (rep.budgetExceeded) {
+        cout << "Budget exceeded while processing " << g.name(rep.stoppedAt)
+             << "; the grammar may still be left-recursive.\n";
+    }
+    if (rep.cyclic) {
+        cout << "Eliminating " << g.name(rep.cyclicAt)
+             << " left a rule that starts with itself: grammar is cyclic; still left-recursive.\n";
+    }
+}
+
 // ----------------------------- Lab 06 & 07: FIRST and FOLLOW -----------------------------
-static set<string> firstOfSequence(const vector<string> &seq,
-                                  const map<string, set<string>> &FIRST,
-                                  const Grammar &g) {
-    set<string> result;
-    if (seq.empty()) {
-        result.insert(EPS);
-        return result;
+// FIRST/FOLLOW sets are dense bitsets, one row per symbol. Bits number the symbols that
+// can appear in a set: bit 0 = EPS, bit 1 = END_MARK, then every other non-nonterminal.
+// A set union is a word-wide OR over the row.
+class SymbolSets {
+public:
+    void init(const Grammar &g) { init(g, g.symtab.size()); }
+
+    // Same bits, but `rows` rows indexed by any id (e.g. LR transitions) instead of Sym.
+    void init(const Grammar &g, size_t rows) {
+        bitOf.assign(g.symtab.size(), -1);
+        bitSym.clear();
+        for (Sym s = 0; s < (Sym)g.symtab.size(); s++) {
+            if (g.isNonTerminal(s)) continue;
+            bitOf[(size_t)s] = (int)bitSym.size();
+            bitSym.push_back(s);
+        }
+        words = (bitSym.size() + 63) / 64;
+        bits.assign(rows * words, 0);
     }
-    bool allEps = true;
-    for (auto &X : seq) {
-        if (X == EPS) {
-            result.insert(EPS);
-            allEps = true;
-            break;
-        }
-        if (g.isTerminal(X) || !g.isNonTerminal(X)) {
-            result.insert(X);
-            allEps = false;
-            break;
-        }
-        auto it = FIRST.find(X);
-        if (it != FIRST.end()) {
-            for (auto &a : it->second) if (a != EPS) result.insert(a);
-            if (it->second.count(EPS)) {
-                // continue
-            } else {
+
+    size_t rowWords() const { return words; }
+    size_t bitCount() const { return bitSym.size(); }
+    // All rows back to back (for the analysis cache).
+    vector<uint64_t> &raw() { return bits; }
+    const vector<uint64_t> &raw() const { return bits; }
+    int bit(Sym x) const { return bitOf[(size_t)x]; }
+    Sym symOfBit(size_t b) const { return bitSym[b]; }
+    uint64_t *row(Sym A) { return &bits[(size_t)A * words]; }
+    const uint64_t *row(Sym A) const { return &bits[(size_t)A * words]; }
+
+    bool has(Sym A, Sym x) const {
+        int b = bit(x);
+        return b >= 0 && (row(A)[b >> 6] >> (b & 63) & 1);
+    }
+
+    // Returns true if x was not in the set yet.
+    bool add(Sym A, Sym x) {
+        int b = bit(x);
+        uint64_t &w = row(A)[b >> 6], m = 1ull << (b & 63);
+        if (w & m) return false;
+        w |= m;
+        return true;
+    }
+
+    // dst |= src, optionally without the EPS bit; returns true if dst grew.
+    bool unite(uint64_t *dst, const uint64_t *src, bool withEps) const {
+        uint64_t grew = 0;
+        for (size_t i = 0; i < words; i++) {
+            uint64_t add = src[i];
+            if (i == 0 && !withEps) add &= ~1ull;
+            grew |= add & ~dst[i];
+            dst[i] |= add;
+        }
+        return grew != 0;
+    }
+
+    // Members of a row, as symbols, in bit order.
+    template <class F>
+    void forEach(const uint64_t *r, F &&f) const {
+        for (size_t i = 0; i < words; i++) {
+            for (uint64_t w = r[i]; w; w &= w - 1) f(bitSym[i * 64 + (size_t)__builtin_ctzll(w)]);
+        }
+    }
+
+private:
+    vector<int> bitOf;   // Sym -> bit, -1 for nonterminals
+    vector<Sym> bitSym;  // bit -> Sym
+    size_t words = 0;
+    vector<uint64_t> bits;
+};
+
+// FIRST(seq) into `out` (rowWords() words, overwritten).
+static void firstOfSequence(const vector<Sym> &seq,
+                            const SymbolSets &FIRST,
+                            const Grammar &g,
+                            uint64_t *out) {
+    fill(out, out + FIRST.rowWords(), 0);
+    auto setBit = [&](Sym x) { int b = FIRST.bit(x); out[b >> 6] |= 1ull << (b & 63); };
+    for (Sym X : seq) {
+        if (X == SYM_EPS) break; // explicit eps: nothing more, FIRST contains eps
+        if (!g.isNonTerminal(X)) {
+            setBit(X);
+            return;
+        }
+        FIRST.unite(out, FIRST.row(X), false);
+        if (!FIRST.has(X, SYM_EPS)) return;
+    }
+    setBit(SYM_EPS); // every symbol could vanish (or seq is empty)
+}
+
+// Worklist fixpoint: only productions that mention a symbol whose FIRST just grew
+// are evaluated again. Returns the number of production evaluations.
+static size_t computeFIRSTWorklist(const Grammar &g, SymbolSets &FIRST) {
+    FIRST.init(g);
+
+    struct ProdRef { Sym A; const vector<Sym> *rhs; };
+    vector<ProdRef> prods;
+    vector<vector<int>> users(g.symtab.size()); // X -> productions with X on the RHS
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            int p = (int)prods.size();
+            prods.push_back({A, &rhs});
+            for (Sym X : rhs) {
+                if (!g.isNonTerminal(X)) continue;
+                auto &u = users[(size_t)X];
+                if (u.empty() || u.back() != p) u.push_back(p);
+            }
+        }
+    }
+
+    vector<int> work(prods.size());
+    iota(work.begin(), work.end(), 0);
+    reverse(work.begin(), work.end()); // pop from the back = grammar order first
+    vector<char> queued(prods.size(), 1);
+
+    size_t evaluated = 0;
+    while (!work.empty()) {
+        int p = work.back();
+        work.pop_back();
+        queued[(size_t)p] = 0;
+        evaluated++;
+        Sym A = prods[(size_t)p].A;
+        uint64_t *FA = FIRST.row(A);
+
+        bool changed = false, allEps = true;
+        for (Sym X : *prods[(size_t)p].rhs) {
+            if (X == SYM_EPS) break;
+            if (!g.isNonTerminal(X)) {
+                changed |= FIRST.add(A, X);
                 allEps = false;
                 break;
             }
-        } else {
-            // unknown symbol: treat as terminal
-            result.insert(X);
-            allEps = false;
-            break;
-        }
-    }
-    if (allEps) result.insert(EPS);
-    return result;
-}
-
-static void computeFIRST(const Grammar &g, map<string, set<string>> &FIRST) {
-    FIRST.clear();
-
-    // Terminals
-    for (auto &t : g.terminals) FIRST[t].insert(t);
-    FIRST[EPS].insert(EPS);
-
-    // Nonterminals
-    for (auto &A : g.nonterminals) FIRST[A]; // ensure exists
-
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (auto &A : g.nonterminals) {
-            for (auto &rhs : g.prod.at(A)) {
-                // Compute FIRST(rhs)
-                bool allEps = true;
-                for (auto &X : rhs) {
-                    if (X == EPS) {
-                        if (!FIRST[A].count(EPS)) {
-                            FIRST[A].insert(EPS);
-                            changed = true;
-                        }
-                        allEps = true;
-                        break;
-                    }
+            changed |= FIRST.unite(FA, FIRST.row(X), false);
+            if (!FIRST.has(X, SYM_EPS)) {
+                allEps = false;
+                break;
+            }
+        }
+        if (allEps) changed |= FIRST.add(A, SYM_EPS);
 
-                    if (g.isTerminal(X) || !g.isNonTerminal(X)) {
-                        if (!FIRST[A].count(X)) {
-                            FIRST[A].insert(X);
-                            changed = true;
-                        }
-                        allEps = false;
-                        break;
-                    }
+        if (!changed) continue;
+        for (int q : users[(size_t)A]) {
+            if (queued[(size_t)q]) continue;
+            queued[(size_t)q] = 1;
+            work.push_back(q);
+        }
+    }
+    return evaluated;
+}
 
-                    // X is nonterminal
-                    for (auto &a : FIRST[X]) {
-                        if (a == EPS) continue;
-                        if (!FIRST[A].count(a)) {
-                            FIRST[A].insert(a);
-                            changed = true;
-                        }
-                    }
-                    if (FIRST[X].count(EPS)) {
-                        // keep going
-                    } else {
-                        allEps = false;
-                        break;
-                    }
+// FOLLOW(B) gets the constant FIRST(beta) - eps for every occurrence A -> alpha B beta,
+// plus FOLLOW(A) along an edge A -> B when beta can vanish. Seeds the constant parts
+// into FOLLOW and returns the edges.
+static vector<vector<Sym>> seedFOLLOW(const Grammar &g,
+                                      const SymbolSets &FIRST,
+                                      SymbolSets &FOLLOW) {
+    FOLLOW.init(g);
+    if (g.start >= 0) FOLLOW.add(g.start, SYM_END);
+
+    vector<vector<Sym>> edges(g.symtab.size()); // A -> B : FOLLOW(B) includes FOLLOW(A)
+    vector<uint64_t> firstBeta(FIRST.rowWords());
+    vector<Sym> beta;
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            for (size_t i = 0; i < rhs.size(); i++) {
+                Sym B = rhs[i];
+                if (!g.isNonTerminal(B)) continue;
+
+                beta.assign(rhs.begin() + (long long)i + 1, rhs.end());
+                firstOfSequence(beta, FIRST, g, firstBeta.data());
+
+                // FIRST(beta) - eps -> FOLLOW(B)
+                FOLLOW.unite(FOLLOW.row(B), firstBeta.data(), false);
+
+                // if eps in FIRST(beta) or beta empty: FOLLOW(A) -> FOLLOW(B)
+                if ((firstBeta[0] & 1) && A != B) edges[(size_t)A].push_back(B);
+            }
+        }
+    }
+    return edges;
+}
+
+// Propagates the edges with a worklist of nonterminals whose FOLLOW grew. Returns
+// the number of nonterminals taken off the worklist.
+static size_t computeFOLLOWWorklist(const Grammar &g,
+                                  const SymbolSets &FIRST,
+                                  SymbolSets &FOLLOW) {
+    vector<vector<Sym>> edges = seedFOLLOW(g, FIRST, FOLLOW);
+
+    vector<Sym> work(g.nonterminals.rbegin(), g.nonterminals.rend());
+    vector<char> queued(g.symtab.size(), 0);
+    for (Sym A : work) queued[(size_t)A] = 1;
+    size_t visited = 0;
+    while (!work.empty()) {
+        Sym A = work.back();
+        work.pop_back();
+        queued[(size_t)A] = 0;
+        visited++;
+        for (Sym B : edges[(size_t)A]) {
+            if (!FOLLOW.unite(FOLLOW.row(B), FOLLOW.row(A), true) || queued[(size_t)B]) continue;
+            queued[(size_t)B] = 1;
+            work.push_back(B);
+        }
+    }
+    return visited;
+}
+
+// DeRemer-Pennello "digraph": F(x) = F'(x) + union of F(y) for every x R y, where
+// `sets` holds F' on entry. A Tarjan walk (iterative, so long chains cannot overflow
+// the stack) collapses each strongly connected component: its members all end up
+// with the root's set, and every set is finished exactly once, in reverse
+// topological order. O(V + E) unions; returns how many were done.
+static size_t digraphClosure(const vector<Sym> &nodes, const vector<vector<Sym>> &R, SymbolSets &sets) {
+    const int DONE = INT_MAX;
+    vector<int> N(R.size(), 0);
+    vector<Sym> stack;
+    struct Frame { Sym x; size_t edge; int depth; };
+    vector<Frame> call;
+
+    auto enter = [&](Sym x) {
+        stack.push_back(x);
+        N[(size_t)x] = (int)stack.size();
+        call.push_back({x, 0, N[(size_t)x]});
+    };
+
+    size_t unions = 0;
+    for (Sym root : nodes) {
+        if (N[(size_t)root]) continue;
+        enter(root);
+        while (!call.empty()) {
+            Frame &f = call.back();
+            Sym x = f.x;
+            if (f.edge < R[(size_t)x].size()) {
+                Sym y = R[(size_t)x][f.edge++];
+                if (N[(size_t)y] == 0) {
+                    enter(y);
+                    continue;
                 }
-                if (allEps) {
-                    if (!FIRST[A].count(EPS)) {
-                        FIRST[A].insert(EPS);
-                        changed = true;
-                    }
+                N[(size_t)x] = min(N[(size_t)x], N[(size_t)y]);
+                sets.unite(sets.row(x), sets.row(y), true);
+                unions++;
+                continue;
+            }
+
+            int depth = f.depth;
+            call.pop_back();
+            if (N[(size_t)x] == depth) {
+                // x is the root of a component: share its set with every member
+                while (true) {
+                    Sym t = stack.back();
+                    stack.pop_back();
+                    N[(size_t)t] = DONE;
+                    if (t == x) break;
+                    copy(sets.row(x), sets.row(x) + sets.rowWords(), sets.row(t));
                 }
             }
+            if (!call.empty()) {
+                Sym p = call.back().x;
+                N[(size_t)p] = min(N[(size_t)p], N[(size_t)x]);
+                sets.unite(sets.row(p), sets.row(x), true);
+                unions++;
+            }
         }
     }
+    return unions;
 }
 
-static void computeFOLLOW(const Grammar &g,
-                          const map<string, set<string>> &FIRST,
-                          map<string, set<string>> &FOLLOW) {
-    FOLLOW.clear();
-    for (auto &A : g.nonterminals) FOLLOW[A]; // ensure exists
-    FOLLOW[g.start].insert(END_MARK);
-
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (auto &A : g.nonterminals) {
-            for (auto &rhs : g.prod.at(A)) {
-                for (size_t i = 0; i < rhs.size(); i++) {
-                    const string &B = rhs[i];
-                    if (!g.isNonTerminal(B)) continue;
-
-                    vector<string> beta(rhs.begin() + (long long)i + 1, rhs.end());
-                    set<string> firstBeta = firstOfSequence(beta, FIRST, g);
-
-                    // FIRST(beta) - eps -> FOLLOW(B)
-                    for (auto &x : firstBeta) {
-                        if (x == EPS) continue;
-                        if (!FOLLOW[B].count(x)) {
-                            FOLLOW[B].insert(x);
-                            changed = true;
-                        }
-                    }
+// Nonterminals that derive eps (with the same reading of an explicit eps inside a
+// RHS as firstOfSequence: the walk stops there). Counter-based, linear time.
+static vector<char> computeNullable(const Grammar &g) {
+    vector<char> nullable(g.symtab.size(), 0);
+    vector<Sym> lhs;
+    vector<int> missing;                         // per production: prefix NTs not yet nullable
+    vector<vector<int>> users(g.symtab.size());  // X -> productions waiting on X
+    vector<Sym> work;
+
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            int p = (int)lhs.size(), need = 0;
+            bool possible = true;
+            for (Sym X : rhs) {
+                if (X == SYM_EPS) break;
+                if (!g.isNonTerminal(X)) { possible = false; break; }
+                users[(size_t)X].push_back(p);
+                need++;
+            }
+            lhs.push_back(A);
+            missing.push_back(possible ? need : -1);
+            if (possible && need == 0 && !nullable[(size_t)A]) {
+                nullable[(size_t)A] = 1;
+                work.push_back(A);
+            }
+        }
+    }
+    while (!work.empty()) {
+        Sym X = work.back();
+        work.pop_back();
+        for (int p : users[(size_t)X]) {
+            if (missing[(size_t)p] <= 0 || --missing[(size_t)p] > 0) continue;
+            Sym A = lhs[(size_t)p];
+            if (nullable[(size_t)A]) continue;
+            nullable[(size_t)A] = 1;
+            work.push_back(A);
+        }
+    }
+    return nullable;
+}
 
-                    // if eps in FIRST(beta) or beta empty: FOLLOW(A) -> FOLLOW(B)
-                    if (beta.empty() || firstBeta.count(EPS)) {
-                        for (auto &x : FOLLOW[A]) {
-                            if (!FOLLOW[B].count(x)) {
-                                FOLLOW[B].insert(x);
-                                changed = true;
-                            }
-                        }
-                    }
+// FIRST(A) - eps is the digraph closure of the terminals that directly start A's
+// productions over "A includes FIRST(X)" edges; eps is added for nullable A.
+// Returns the number of unions.
+static size_t computeFIRSTDigraph(const Grammar &g, SymbolSets &FIRST) {
+    FIRST.init(g);
+    vector<char> nullable = computeNullable(g);
+    vector<vector<Sym>> R(g.symtab.size());
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            for (Sym X : rhs) {
+                if (X == SYM_EPS) break;
+                if (!g.isNonTerminal(X)) {
+                    FIRST.add(A, X);
+                    break;
                 }
+                R[(size_t)A].push_back(X);
+                if (!nullable[(size_t)X]) break;
             }
         }
     }
+    size_t unions = digraphClosure(g.nonterminals, R, FIRST);
+    for (Sym A : g.nonterminals)
+        if (nullable[(size_t)A]) FIRST.add(A, SYM_EPS);
+    return unions;
+}
+
+static size_t computeFOLLOWDigraph(const Grammar &g,
+                                 const SymbolSets &FIRST,
+                                 SymbolSets &FOLLOW) {
+    vector<vector<Sym>> edges = seedFOLLOW(g, FIRST, FOLLOW);
+    vector<vector<Sym>> R(g.symtab.size()); // B R A : FOLLOW(B) includes FOLLOW(A)
+    for (Sym A : g.nonterminals)
+        for (Sym B : edges[(size_t)A]) R[(size_t)B].push_back(A);
+    return digraphClosure(g.nonterminals, R, FOLLOW);
+}
+
+// Both engines give identical sets. MINI_COMPILER_SETS=digraph selects the SCC one.
+enum class SetEngine { Worklist, Digraph };
+
+static SetEngine defaultSetEngine() {
+    static const SetEngine e = [] {
+        const char *v = getenv("MINI_COMPILER_SETS");
+        return (v && string(v) == "digraph") ? SetEngine::Digraph : SetEngine::Worklist;
+    }();
+    return e;
+}
+
+// Sets only grow, so the members left at the end are exactly the insertions made.
+static size_t countSetMembers(const Grammar &g, const SymbolSets &sets) {
+    size_t n = 0;
+    for (Sym A : g.nonterminals) {
+        const uint64_t *r = sets.row(A);
+        for (size_t i = 0; i < sets.rowWords(); i++) n += (size_t)__builtin_popcountll(r[i]);
+    }
+    return n;
+}
+
+// Iterations are worklist evaluations, or unions with the digraph engine.
+static void computeFIRST(const Grammar &g, SymbolSets &FIRST, SetEngine engine = defaultSetEngine()) {
+    PhaseScope stats(Phase::FIRST);
+    stats.add(STAT_ITERATIONS, engine == SetEngine::Digraph ? computeFIRSTDigraph(g, FIRST)
+                                                            : computeFIRSTWorklist(g, FIRST));
+    if (stats.active()) stats.add(STAT_INSERTIONS, countSetMembers(g, FIRST));
+}
+
+static void computeFOLLOW(const Grammar &g,
+                          const SymbolSets &FIRST,
+                          SymbolSets &FOLLOW,
+                          SetEngine engine = defaultSetEngine()) {
+    PhaseScope stats(Phase::FOLLOW);
+    stats.add(STAT_ITERATIONS, engine == SetEngine::Digraph ? computeFOLLOWDigraph(g, FIRST, FOLLOW)
+                                                            : computeFOLLOWWorklist(g, FIRST, FOLLOW));
+    if (stats.active()) stats.add(STAT_INSERTIONS, countSetMembers(g, FOLLOW));
+}
+
+// Names of a set row in name order (how the sets are printed).
+static vector<string> sortedNames(const Grammar &g, const SymbolSets &sets, Sym A) {
+    vector<string> names;
+    sets.forEach(sets.row(A), [&](Sym x) { names.push_back(g.name(x)); });
+    sort(names.begin(), names.end());
+    return names;
 }
 
 static void printFIRSTFOLLOW(const Grammar &g,
-                            const map<string, set<string>> &FIRST,
-                            const map<string, set<string>> &FOLLOW) {
+                            const SymbolSets &FIRST,
+                            const SymbolSets &FOLLOW) {
     cout << "\n--- FIRST sets ---\n";
-    for (auto &A : g.nonterminals) {
-        cout << "FIRST(" << A << ") = { ";
-        for (auto &x : FIRST.at(A)) cout << x << " ";
+    for (Sym A : g.nonterminals) {
+        cout << "FIRST(" << g.name(A) << ") = { ";
+        for (auto &x : sortedNames(g, FIRST, A)) cout << x << " ";
         cout << "}\n";
     }
     cout << "\n--- FOLLOW sets ---\n";
-    for (auto &A : g.nonterminals) {
-        cout << "FOLLOW(" << A << ") = { ";
-        for (auto &x : FOLLOW.at(A)) cout << x << " ";
+    for (Sym A : g.nonterminals) {
+        cout << "FOLLOW(" << g.name(A) << ") = { ";
+        for (auto &x : sortedNames(g, FOLLOW, A)) cout << x << " ";
         cout << "}\n";
     }
 }
 
 // ----------------------------- Lab 08: LL(1) Parsing Table -----------------------------
-struct ParseTableCell {
-    bool filled = false;
+// Dense LL(1) table: M[A, a] is a production index (or NO_RULE / CONFLICT). Rows are
+// nonterminals, columns terminals plus $. LL(1) tables are mostly empty, so rows are
+// packed with row displacement: row r lives at slots[base[r] + column], and a slot
+// only belongs to r when its owner says so. Lookup is one load from base and one
+// from slots.
+struct ParseTable {
+    static constexpr int NO_RULE = -1;
+    static constexpr int CONFLICT = -2;
+
+    struct Slot {
+        int owner = -1; // row that placed this entry
+        int prod = NO_RULE;
+    };
+
+    vector<int> rowOf;          // Sym -> row, -1 for non-nonterminals
+    vector<int> colOf;          // Sym -> column, -1 for non-terminals
+    vector<int> base;           // row -> displacement into slots
+    vector<Slot> slots;
+    vector<Sym> prodLhs;        // production index -> A
+    vector<vector<Sym>> prodRhs; // production index -> alpha
+    vector<int> pushBegin;      // production p pushes pushSyms[pushBegin[p] .. pushBegin[p + 1])
+    vector<Sym> pushSyms;       // alpha reversed, eps dropped
     bool conflict = false;
-    vector<string> rhs; // production RHS
-    string fromA; // nonterminal (optional)
-};
 
-static void buildParseTable(const Grammar &g,
-                            const map<string, set<string>> &FIRST,
-                            const map<string, set<string>> &FOLLOW,
-                            map<string, map<string, ParseTableCell>> &table,
-                            vector<string> &tableTerminalsSorted) {
-    table.clear();
+    int lookup(Sym A, Sym a) const {
+        if ((size_t)A >= rowOf.size() || (size_t)a >= colOf.size()) return NO_RULE;
+        int r = rowOf[(size_t)A], c = colOf[(size_t)a];
+        if (r < 0 || c < 0) return NO_RULE;
+        const Slot &s = slots[(size_t)(base[(size_t)r] + c)];
+        return s.owner == r ? s.prod : NO_RULE;
+    }
+};
 
-    set<string> cols = g.terminals;
-    cols.insert(END_MARK);
-    tableTerminalsSorted.assign(cols.begin(), cols.end());
+// First-fit row displacement, densest rows first. rows[r] lists (column, value) pairs
+// with ascending columns; a slot whose owner is not r reads as "no entry".
+static void packRows(const vector<vector<pair<int, int>>> &rows,
+                     size_t cols,
+                     vector<int> &base,
+                     vector<ParseTable::Slot> &slots) {
+    vector<size_t> order(rows.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return rows[x].size() > rows[y].size(); });
+
+    base.assign(rows.size(), 0);
+    slots.assign(cols, ParseTable::Slot{});
+    // nextFree: union-find over slots, find(i) = first free slot >= i. A row's first
+    // column must land on a free slot, so only those displacements are tried.
+    vector<size_t> nextFree(cols + 1);
+    iota(nextFree.begin(), nextFree.end(), 0);
+    auto findFree = [&](size_t i) {
+        while (nextFree[i] != i) {
+            nextFree[i] = nextFree[nextFree[i]];
+            i = nextFree[i];
+        }
+        return i;
+    };
+    // Occupancy bitmap: a candidate is tested 64 columns at a time against the row's
+    // column mask, which keeps first-fit fast for long, dense rows.
+    const size_t W = (cols + 63) / 64;
+    vector<uint64_t> taken(W + 2, 0), mask(W);
+    vector<size_t> maskWords; // words of mask that are non-zero
+    auto window = [&](size_t pos) {
+        size_t w = pos >> 6, sh = pos & 63;
+        uint64_t x = taken[w] >> sh;
+        if (sh) x |= taken[w + 1] << (64 - sh);
+        return x;
+    };
+    auto fits = [&](size_t b) {
+        size_t need = ((b + 64 * W) >> 6) + 2;
+        if (taken.size() < need) taken.resize(need, 0);
+        for (size_t w : maskWords)
+            if (window(b + 64 * w) & mask[w]) return false;
+        return true;
+    };
 
-    for (auto &A : g.nonterminals) {
-        for (auto &a : cols) table[A][a] = ParseTableCell{};
+    // Occupancy only grows, so a row can start searching just past where the last row
+    // with the same columns went: every earlier displacement failed for that pattern.
+    // Keeps exact first-fit while LR tables, with thousands of look-alike rows, stay fast.
+    map<vector<int>, size_t> resumeAt;
+    vector<int> pattern;
+
+    for (size_t r : order) {
+        if (rows[r].empty()) continue;
+        maskWords.clear();
+        pattern.clear();
+        for (auto &e : rows[r]) {
+            size_t w = (size_t)e.first >> 6;
+            if (!mask[w]) maskWords.push_back(w);
+            mask[w] |= 1ull << (e.first & 63);
+            pattern.push_back(e.first);
+        }
+        size_t c0 = (size_t)rows[r][0].first;
+        size_t &resume = resumeAt[pattern];
+        size_t b = findFree(resume + c0) - c0;
+        while (!fits(b)) b = findFree(b + c0 + 1) - c0;
+        resume = b + 1;
+        for (size_t w : maskWords) mask[w] = 0;
+
+        if (b + cols > slots.size()) {
+            size_t old = slots.size();
+            slots.resize(b + cols);
+            nextFree.resize(b + cols + 1);
+            iota(nextFree.begin() + (long long)old + 1, nextFree.end(), old + 1);
+        }
+        base[r] = (int)b;
+        for (auto &e : rows[r]) {
+            size_t k = b + (size_t)e.first;
+            slots[k] = ParseTable::Slot{(int)r, e.second};
+            nextFree[k] = k + 1;
+            taken[k >> 6] |= 1ull << (k & 63);
+        }
     }
+}
 
-    for (auto &A : g.nonterminals) {
-        for (auto &rhs : g.prod.at(A)) {
-            set<string> firstAlpha = firstOfSequence(rhs, FIRST, g);
+static void packParseTable(ParseTable &t, const vector<int> &dense, size_t rows, size_t cols) {
+    vector<vector<pair<int, int>>> sparse(rows);
+    for (size_t r = 0; r < rows; r++)
+        for (size_t c = 0; c < cols; c++)
+            if (dense[r * cols + c] != ParseTable::NO_RULE) sparse[r].push_back({(int)c, dense[r * cols + c]});
+    packRows(sparse, cols, t.base, t.slots);
+}
 
-            // For each terminal in FIRST(alpha) except eps
-            for (auto &t : firstAlpha) {
-                if (t == EPS) continue;
-                auto &cell = table[A][t];
-                if (!cell.filled) {
-                    cell.filled = true;
-                    cell.rhs = rhs;
-                    cell.fromA = A;
+static void buildParseTable(const Grammar &g,
+                            const SymbolSets &FIRST,
+                            const SymbolSets &FOLLOW,
+                            ParseTable &table,
+                            vector<Sym> &tableTerminalsSorted) {
+    PhaseScope stats(Phase::ParseTable);
+    table = ParseTable{};
+
+    vector<Sym> cols = g.terminals;
+    if (!g.isTerminal(SYM_END)) cols.push_back(SYM_END);
+    sort(cols.begin(), cols.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+    tableTerminalsSorted = cols;
+
+    table.rowOf.assign(g.symtab.size(), -1);
+    table.colOf.assign(g.symtab.size(), -1);
+    for (size_t r = 0; r < g.nonterminals.size(); r++) table.rowOf[(size_t)g.nonterminals[r]] = (int)r;
+    for (size_t c = 0; c < cols.size(); c++) table.colOf[(size_t)cols[c]] = (int)c;
+
+    size_t nrows = g.nonterminals.size(), ncols = cols.size();
+    vector<int> dense(nrows * ncols, ParseTable::NO_RULE);
+
+    vector<uint64_t> firstAlpha(FIRST.rowWords());
+    for (size_t r = 0; r < nrows; r++) {
+        Sym A = g.nonterminals[r];
+        int *row = dense.data() + r * ncols;
+        for (auto &rhs : g.prod[(size_t)A]) {
+            int p = (int)table.prodLhs.size();
+            table.prodLhs.push_back(A);
+            table.prodRhs.push_back(rhs);
+            firstOfSequence(rhs, FIRST, g, firstAlpha.data());
+
+            auto place = [&](Sym t) {
+                int &cell = row[table.colOf[(size_t)t]];
+                if (cell == ParseTable::NO_RULE) {
+                    cell = p;
                 } else {
-                    cell.conflict = true;
+                    if (cell != ParseTable::CONFLICT) stats.add(STAT_CONFLICTS); // count each cell once
+                    cell = ParseTable::CONFLICT;
+                    table.conflict = true;
                 }
-            }
+            };
+
+            // For each terminal in FIRST(alpha) except eps
+            FIRST.forEach(firstAlpha.data(), [&](Sym t) {
+                if (t != SYM_EPS) place(t);
+            });
 
             // If eps in FIRST(alpha), add to FOLLOW(A)
-            if (firstAlpha.count(EPS)) {
-                for (auto &b : FOLLOW.at(A)) {
-                    auto &cell = table[A][b];
-                    if (!cell.filled) {
-                        cell.filled = true;
-                        cell.rhs = rhs;
-                        cell.fromA = A;
-                    } else {
-                        cell.conflict = true;
-                    }
-                }
-            }
+            if (firstAlpha[0] & 1) FOLLOW.forEach(FOLLOW.row(A), place);
         }
     }
+
+    for (auto &rhs : table.prodRhs) {
+        table.pushBegin.push_back((int)table.pushSyms.size());
+        for (auto it = rhs.rbegin(); it != rhs.rend(); ++it)
+            if (*it != SYM_EPS) table.pushSyms.push_back(*it);
+    }
+    table.pushBegin.push_back((int)table.pushSyms.size());
+
+    packParseTable(table, dense, nrows, ncols);
 }
 
 static void printParseTable(const Grammar &g,
-                            const map<string, map<string, ParseTableCell>> &table,
-                            const vector<string> &cols) {
+                            const ParseTable &table,
+                            const vector<Sym> &cols) {
     cout << "\n--- LL(1) Parsing Table ---\n";
     cout << setw(10) << "NT\\T";
-    for (auto &t : cols) cout << setw(12) << t;
+    for (Sym t : cols) cout << setw(12) << g.name(t);
     cout << "\n";
 
-    for (auto &A : g.nonterminals) {
-        cout << setw(10) << A;
-        for (auto &t : cols) {
-            const auto &cell = table.at(A).at(t);
-            if (!cell.filled) {
+    for (Sym A : g.nonterminals) {
+        cout << setw(10) << g.name(A);
+        for (Sym t : cols) {
+            int p = table.lookup(A, t);
+            if (p == ParseTable::NO_RULE) {
                 cout << setw(12) << ".";
-            } else if (cell.conflict) {
+            } else if (p == ParseTable::CONFLICT) {
                 cout << setw(12) << "CONFLICT";
             } else {
-                string pr = A + "->" + joinSymbols(cell.rhs);
+                string pr = g.name(A) + "->" + g.rhsToString(table.prodRhs[(size_t)p]);
                 if (pr.size() > 10) pr = pr.substr(0, 9) + "..";
                 cout << setw(12) << pr;
             }
@@ -662,37 +1522,1005 @@ static void printParseTable(const Grammar &g,
         cout << "\n";
     }
 
-    bool hasConflict = false;
-    for (auto &A : g.nonterminals)
-        for (auto &t : cols)
-            if (table.at(A).at(t).conflict) hasConflict = true;
-
-    if (hasConflict) {
+    if (table.conflict) {
         cout << "\nWARNING: Conflicts detected. Grammar may NOT be LL(1).\n";
     } else {
         cout << "\nNo conflicts detected. Grammar looks LL(1).\n";
     }
 }
 
-// ----------------------------- Lab 09: Predictive Parser -----------------------------
-static vector<string> tokenizeExpressionInput(const string &s) {
-    // Converts input like: id+id*id, a+b*(c) into tokens: id + id * id etc.
-    vector<string> out;
-    for (size_t i = 0; i < s.size();) {
-        char c = s[i];
-        if (isspace((unsigned char)c)) {
-            i++;
-            continue;
-        }
-        if (isalpha((unsigned char)c) || c=='_') {
-            size_t j = i;
-            while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j]=='_')) j++;
-            string word = s.substr(i, j - i);
-            // Treat any identifier as "id" (fits expression grammar)
-            out.push_back("id");
-            i = j;
-            continue;
-        }
+// ----------------------------- Analysis Cache -----------------------------
+// Cases 05-07 and 09 all run the same pipeline: optional preprocessing (left-recursion
+// elimination + left factoring), FIRST, FOLLOW and the LL(1) table. The result is
+// stored in one binary file per input grammar, named by an FNV-1a hash of the
+// normalized grammar text plus the preprocessing flag, so a grammar seen before is
+// loaded with a single read instead of being analysed again.
+// MINI_COMPILER_CACHE=DIR moves the cache (default .mini_compiler_cache), =off disables it.
+struct GrammarAnalysis {
+    Grammar g;         // after preprocessing
+    SymbolSets FIRST, FOLLOW;
+    ParseTable table;
+    vector<Sym> cols;  // table columns in print order
+};
+
+static const char CACHE_MAGIC[8] = {'M', 'C', 'G', 'C', 'A', 'C', 'H', 'E'};
+static const uint32_t CACHE_VERSION = 1;
+
+static uint64_t fnv1a64(string_view s, uint64_t h = 1469598103934665603ull) {
+    for (unsigned char c : s) h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+// One rule per line, nonterminals in name order, single spaces: grammars that differ
+// only in layout or rule order map to the same text.
+static string normalizedGrammarText(const Grammar &g) {
+    string s = "start " + (g.start >= 0 ? g.name(g.start) : string()) + "\n";
+    for (Sym A : g.nonterminals) {
+        s += g.name(A) + " ->";
+        const auto &alts = g.prod[(size_t)A];
+        for (size_t i = 0; i < alts.size(); i++) s += (i ? " | " : " ") + g.rhsToString(alts[i]);
+        s += "\n";
+    }
+    return s;
+}
+
+static string analysisCacheDir() {
+    const char *v = getenv("MINI_COMPILER_CACHE");
+    if (!v) return ".mini_compiler_cache";
+    string dir = v;
+    return dir == "off" ? string() : dir;
+}
+
+// Flat little helpers for the file body: PODs as raw bytes, vectors as count + bytes,
+// nested vectors as a count per row followed by all rows back to back.
+struct CacheWriter {
+    string buf;
+
+    template <class T>
+    void pod(const T &v) { buf.append((const char *)&v, sizeof v); }
+
+    template <class T>
+    void vec(const vector<T> &v) {
+        pod((uint64_t)v.size());
+        buf.append((const char *)v.data(), v.size() * sizeof(T));
+    }
+
+    void str(const string &s) {
+        pod((uint64_t)s.size());
+        buf += s;
+    }
+
+    void nested(const vector<vector<Sym>> &rows) {
+        vector<uint32_t> len;
+        vector<Sym> all;
+        for (auto &r : rows) {
+            len.push_back((uint32_t)r.size());
+            all.insert(all.end(), r.begin(), r.end());
+        }
+        vec(len);
+        vec(all);
+    }
+};
+
+struct CacheReader {
+    const char *p, *end;
+    bool ok = true;
+
+    template <class T>
+    void pod(T &v) {
+        if ((size_t)(end - p) < sizeof v) ok = false;
+        if (!ok) return;
+        memcpy(&v, p, sizeof v);
+        p += sizeof v;
+    }
+
+    template <class T>
+    void vec(vector<T> &v) {
+        uint64_t n = 0;
+        pod(n);
+        if (!ok || n > (uint64_t)(end - p) / sizeof(T)) {
+            ok = false;
+            return;
+        }
+        v.resize((size_t)n);
+        memcpy(v.data(), p, (size_t)n * sizeof(T));
+        p += n * sizeof(T);
+    }
+
+    void str(string &s) {
+        uint64_t n = 0;
+        pod(n);
+        if (!ok || n > (uint64_t)(end - p)) {
+            ok = false;
+            return;
+        }
+        s.assign(p, (size_t)n);
+        p += n;
+    }
+
+    void nested(vector<vector<Sym>> &rows) {
+        vector<uint32_t> len;
+        vector<Sym> all;
+        vec(len);
+        vec(all);
+        if (!ok) return;
+        rows.assign(len.size(), {});
+        size_t at = 0;
+        for (size_t i = 0; i < len.size() && ok; i++) {
+            if (len[i] > all.size() - at) {
+                ok = false;
+                break;
+            }
+            rows[i].assign(all.begin() + (long long)at, all.begin() + (long long)(at + len[i]));
+            at += len[i];
+        }
+    }
+};
+
+static string encodeGrammarAnalysis(const string &key, const GrammarAnalysis &a) {
+    CacheWriter w;
+    w.buf.append(CACHE_MAGIC, sizeof CACHE_MAGIC);
+    w.pod(CACHE_VERSION);
+    w.str(key); // compared on load, so a hash collision cannot return the wrong grammar
+
+    const Grammar &g = a.g;
+    w.pod((uint64_t)g.symtab.size());
+    for (size_t s = 0; s < g.symtab.size(); s++) w.str(g.symtab.name((Sym)s));
+    w.pod(g.start);
+    w.vec(g.nonterminals);
+    w.vec(g.terminals);
+    for (Sym A : g.nonterminals) w.nested(g.prod[(size_t)A]);
+
+    w.vec(a.FIRST.raw());
+    w.vec(a.FOLLOW.raw());
+
+    const ParseTable &t = a.table;
+    w.vec(t.rowOf);
+    w.vec(t.colOf);
+    w.vec(t.base);
+    w.vec(t.slots);
+    w.vec(t.prodLhs);
+    w.nested(t.prodRhs);
+    w.vec(t.pushBegin);
+    w.vec(t.pushSyms);
+    w.pod((uint8_t)t.conflict);
+    w.vec(a.cols);
+    return move(w.buf);
+}
+
+// The key only proves which grammar a file was written for, not that its body survived.
+// Every index the parsers and printers follow without checking is checked here, so a
+// damaged file is rejected instead of being trusted.
+static bool decodedAnalysisInRange(const GrammarAnalysis &a) {
+    const Grammar &g = a.g;
+    const ParseTable &t = a.table;
+    const size_t nsyms = g.symtab.size(), nrows = g.nonterminals.size(), ncols = a.cols.size();
+    const size_t nprods = t.prodLhs.size();
+    auto known = [&](Sym s) { return s == SYM_EPS || g.isNonTerminal(s) || g.isTerminal(s); };
+    auto knownRhs = [&](const vector<Sym> &rhs) { return all_of(rhs.begin(), rhs.end(), known); };
+
+    if (nsyms < 2 || (nrows && !g.isNonTerminal(g.start)) || (!nrows && g.start != -1)) return false;
+    for (Sym A : g.nonterminals)
+        if (A == SYM_EPS || A == SYM_END || g.isTerminal(A)) return false;
+    for (Sym x : g.terminals)
+        if (x == SYM_EPS) return false;
+    for (Sym A : g.nonterminals)
+        for (auto &rhs : g.prod[(size_t)A])
+            if (!knownRhs(rhs)) return false;
+
+    if (t.rowOf.size() != nsyms || t.colOf.size() != nsyms || t.base.size() != nrows) return false;
+    for (size_t r = 0; r < nrows; r++)
+        if (t.rowOf[(size_t)g.nonterminals[r]] != (int)r) return false;
+    // every row and column belongs to exactly one symbol
+    if ((size_t)count_if(t.rowOf.begin(), t.rowOf.end(), [](int r) { return r != -1; }) != nrows) return false;
+    if ((size_t)count_if(t.colOf.begin(), t.colOf.end(), [](int c) { return c != -1; }) != ncols) return false;
+    for (size_t c = 0; c < ncols; c++) {
+        Sym x = a.cols[c];
+        if (x < 0 || (size_t)x >= nsyms || (x != SYM_END && !g.isTerminal(x)) || t.colOf[(size_t)x] != (int)c)
+            return false;
+    }
+    for (int b : t.base)
+        if (b < 0 || (size_t)b + ncols > t.slots.size()) return false;
+    for (const auto &s : t.slots) {
+        if (s.owner < -1 || s.owner >= (int)nrows) return false;
+        if (s.prod != ParseTable::NO_RULE && s.prod != ParseTable::CONFLICT && (s.prod < 0 || (size_t)s.prod >= nprods))
+            return false;
+    }
+
+    if (t.prodRhs.size() != nprods || t.pushBegin.size() != nprods + 1) return false;
+    for (size_t p = 0; p < nprods; p++)
+        if (!g.isNonTerminal(t.prodLhs[p]) || !knownRhs(t.prodRhs[p])) return false;
+    if (t.pushBegin[0] != 0 || (size_t)t.pushBegin.back() != t.pushSyms.size()) return false;
+    for (size_t p = 0; p < nprods; p++)
+        if (t.pushBegin[p] > t.pushBegin[p + 1]) return false;
+    for (Sym x : t.pushSyms)
+        if (x == SYM_EPS || !known(x)) return false;
+
+    // forEach maps every set bit back through bitSym, so no row may set a padding bit.
+    const size_t W = a.FIRST.rowWords(), nbits = a.FIRST.bitCount();
+    for (const SymbolSets *sets : {&a.FIRST, &a.FOLLOW}) {
+        if (sets->rowWords() != W || sets->bitCount() != nbits || sets->raw().size() != nsyms * W) return false;
+        if (nbits % 64 == 0) continue;
+        const uint64_t pad = ~0ull << (nbits % 64);
+        for (size_t s = 0; s < nsyms; s++)
+            if (sets->row((Sym)s)[W - 1] & pad) return false;
+    }
+    return true;
+}
+
+static bool decodeGrammarAnalysis(string_view data, const string &key, GrammarAnalysis &a) {
+    CacheReader r{data.data(), data.data() + data.size()};
+    if (data.size() < sizeof CACHE_MAGIC || memcmp(data.data(), CACHE_MAGIC, sizeof CACHE_MAGIC) != 0) return false;
+    r.p += sizeof CACHE_MAGIC;
+    uint32_t version = 0;
+    string storedKey;
+    r.pod(version);
+    r.str(storedKey);
+    if (!r.ok || version != CACHE_VERSION || storedKey != key) return false;
+
+    a = GrammarAnalysis{};
+    Grammar &g = a.g;
+    uint64_t symbols = 0;
+    r.pod(symbols);
+    string name;
+    for (uint64_t s = 0; s < symbols && r.ok; s++) {
+        r.str(name);
+        if (r.ok && g.intern(name) != (Sym)s) r.ok = false;
+    }
+    r.pod(g.start);
+    r.vec(g.nonterminals);
+    r.vec(g.terminals);
+    if (!r.ok) return false;
+    for (Sym A : g.nonterminals) {
+        if (A < 0 || (size_t)A >= g.symtab.size()) return false;
+        g.ntFlag[(size_t)A] = 1;
+        r.nested(g.prod[(size_t)A]);
+    }
+    for (Sym x : g.terminals) {
+        if (x < 0 || (size_t)x >= g.symtab.size()) return false;
+        g.termFlag[(size_t)x] = 1;
+    }
+
+    a.FIRST.init(g);
+    a.FOLLOW.init(g);
+    size_t words = a.FIRST.raw().size();
+    r.vec(a.FIRST.raw());
+    r.vec(a.FOLLOW.raw());
+    if (!r.ok || a.FIRST.raw().size() != words || a.FOLLOW.raw().size() != words) return false;
+
+    ParseTable &t = a.table;
+    uint8_t conflict = 0;
+    r.vec(t.rowOf);
+    r.vec(t.colOf);
+    r.vec(t.base);
+    r.vec(t.slots);
+    r.vec(t.prodLhs);
+    r.nested(t.prodRhs);
+    r.vec(t.pushBegin);
+    r.vec(t.pushSyms);
+    r.pod(conflict);
+    r.vec(a.cols);
+    t.conflict = conflict != 0;
+    return r.ok && r.p == r.end && decodedAnalysisInRange(a);
+}
+
+static void analyseGrammar(Grammar input, bool preprocess, GrammarAnalysis &a) {
+    a.g = move(input);
+    if (preprocess) {
+        eliminateLeftRecursion(a.g);
+        leftFactor(a.g);
+    }
+    a.g.recomputeSymbols();
+    computeFIRST(a.g, a.FIRST);
+    computeFOLLOW(a.g, a.FIRST, a.FOLLOW);
+    buildParseTable(a.g, a.FIRST, a.FOLLOW, a.table, a.cols);
+}
+
+// analyseGrammar through the cache. Returns true if the result came from disk. Any
+// cache problem (missing, stale, corrupt, unwritable) just means analysing again.
+static bool analyseGrammarCached(Grammar input, bool preprocess, GrammarAnalysis &a) {
+    string dir = analysisCacheDir();
+    if (dir.empty() || input.nonterminals.empty()) {
+        analyseGrammar(move(input), preprocess, a);
+        return false;
+    }
+    PhaseScope stats(Phase::GrammarCache);
+    string key = string(preprocess ? "preprocess\n" : "as-is\n") + normalizedGrammarText(input);
+    char hex[17];
+    snprintf(hex, sizeof hex, "%016llx", (unsigned long long)fnv1a64(key));
+    filesystem::path path = filesystem::path(dir) / (string(hex) + ".mcg");
+
+    ifstream in(path, ios::binary | ios::ate);
+    if (in) {
+        string data((size_t)in.tellg(), '\0');
+        in.seekg(0);
+        if (in.read(&data[0], (streamsize)data.size()) && decodeGrammarAnalysis(data, key, a)) {
+            stats.add(STAT_HITS);
+            stats.add(STAT_BYTES, data.size());
+            return true;
+        }
+    }
+
+    stats.add(STAT_MISSES);
+    analyseGrammar(move(input), preprocess, a);
+    string data = encodeGrammarAnalysis(key, a);
+    // write aside and rename, so a concurrent reader never sees half a file
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+    filesystem::path tmp = path;
+    tmp += ".tmp" + to_string(chrono::steady_clock::now().time_since_epoch().count());
+    {
+        ofstream out(tmp, ios::binary);
+        if (!out || !out.write(data.data(), (streamsize)data.size())) return false;
+    }
+    filesystem::rename(tmp, path, ec);
+    if (ec) filesystem::remove(tmp, ec);
+    else stats.add(STAT_BYTES, data.size());
+    return false;
+}
+
+// ----------------------------- Incremental Analysis -----------------------------
+// FIRST, FOLLOW and a dense LL(1) table that follow single-production edits without a
+// full recomputation. Adding a production only grows the least fixpoints, so the
+// sets are pushed up from their current values along a worklist. Removing one can
+// shrink them: the rows that may depend on the edit (judged by the old sets, whose
+// dependencies include the new ones) are solved again in dependency order while the
+// rest stay fixed. Table rows are rebuilt only for nonterminals whose productions,
+// FIRST inputs or FOLLOW changed, and every cell that changes is reported.
+// Edits that introduce a new symbol (or terminal column) fall back to a full rebuild.
+class IncrementalAnalysis {
+public:
+    struct CellChange {
+        Sym A, a;
+        string before, after; // "A -> alpha", "CONFLICT", or "" for an empty cell
+    };
+
+    struct EditReport {
+        bool applied = false;
+        bool fullRebuild = false;
+        size_t firstChanged = 0, followChanged = 0, rowsRebuilt = 0, newConflicts = 0;
+        vector<CellChange> cells;
+    };
+
+    explicit IncrementalAnalysis(Grammar grammar) : g(move(grammar)) {
+        g.recomputeSymbols();
+        rebuildAll();
+    }
+
+    // Starts from an analysis that already has the sets (e.g. from the cache).
+    explicit IncrementalAnalysis(GrammarAnalysis an)
+        : g(move(an.g)), FIRST(move(an.FIRST)), FOLLOW(move(an.FOLLOW)) {
+        buildIndex();
+    }
+
+    const Grammar &grammar() const { return g; }
+    const SymbolSets &first() const { return FIRST; }
+    const SymbolSets &follow() const { return FOLLOW; }
+    const vector<Sym> &columns() const { return cols; }
+    size_t conflicts() const { return conflictCells; }
+
+    // Packed table for the current grammar, for printing or parsing.
+    void exportTable(ParseTable &table, vector<Sym> &tableCols) const {
+        buildParseTable(g, FIRST, FOLLOW, table, tableCols);
+    }
+
+    // Index into grammar().prod[A], or ParseTable::NO_RULE / CONFLICT.
+    int cell(Sym A, Sym a) const {
+        if ((size_t)A >= rowOf.size() || (size_t)a >= colOf.size()) return ParseTable::NO_RULE;
+        int r = rowOf[(size_t)A], c = colOf[(size_t)a];
+        if (r < 0 || c < 0) return ParseTable::NO_RULE;
+        return cells[(size_t)r * cols.size() + (size_t)c];
+    }
+
+    string describe(Sym A, int v) const { return describe(g.prod[(size_t)A], A, v); }
+
+    // "A -> alpha" (one alternative per call; "A -> x | y" applies each in turn).
+    EditReport addProduction(const string &rule) { return editByName(rule, true); }
+    EditReport removeProduction(const string &rule) { return editByName(rule, false); }
+
+    EditReport addProduction(Sym A, const vector<Sym> &rhs) {
+        PhaseScope stats(Phase::IncrementalEdit);
+        EditReport rep = insert(A, rhs);
+        record(stats, rep);
+        return rep;
+    }
+
+    EditReport removeProduction(Sym A, const vector<Sym> &rhs) {
+        PhaseScope stats(Phase::IncrementalEdit);
+        EditReport rep = erase(A, rhs);
+        record(stats, rep);
+        return rep;
+    }
+
+private:
+    Grammar g;
+    SymbolSets FIRST, FOLLOW;
+    vector<Sym> cols;
+    vector<int> rowOf, colOf;
+    vector<int> cells; // row-major, nonterminals x cols
+    size_t conflictCells = 0;
+    vector<unordered_map<Sym, int>> mentions; // X -> B -> how many of B's productions contain X
+    vector<int> mark;                         // per symbol, == stamp while in the current region
+    int stamp = 0;
+    vector<char> queued;                      // per symbol, on the current worklist
+    vector<int> dfn, low;                     // Tarjan scratch for resolveRegion
+    vector<int> compOf;                       // region symbol -> its component in resolveRegion
+    vector<char> onStack, stale;
+
+    static void record(PhaseScope &stats, const EditReport &rep) {
+        stats.add(STAT_STEPS, rep.applied);
+        stats.add(STAT_ITERATIONS, rep.rowsRebuilt);
+        stats.add(STAT_CONFLICTS, rep.newConflicts);
+    }
+
+    EditReport insert(Sym A, const vector<Sym> &rhs) {
+        EditReport rep;
+        if (!fitsCurrentColumns(A, rhs)) {
+            Grammar before = g;
+            g.addNonTerminal(A);
+            if (g.start < 0) g.start = A;
+            g.prod[(size_t)A].push_back(rhs);
+            g.recomputeSymbols();
+            rebuildAfter(before, A, rep);
+            return rep;
+        }
+        vector<vector<Sym>> oldAlts = g.prod[(size_t)A];
+        g.prod[(size_t)A].push_back(rhs);
+        noteMentions(A, rhs, +1);
+        rep.applied = true;
+
+        vector<Sym> firstChanged, followChanged;
+        growFIRST(A, firstChanged);
+        vector<Sym> seeds = followSeeds(rhs, firstChanged);
+        growFOLLOW(seeds, followChanged);
+        rebuildRows(A, oldAlts, firstChanged, followChanged, rep);
+        return rep;
+    }
+
+    EditReport erase(Sym A, const vector<Sym> &rhs) {
+        EditReport rep;
+        if (!g.isNonTerminal(A)) return rep;
+        auto &alts = g.prod[(size_t)A];
+        auto it = find(alts.begin(), alts.end(), rhs);
+        if (it == alts.end()) return rep;
+
+        // Regions are judged on the old sets, before anything changes.
+        vector<Sym> firstRegion = firstRegionOf(A);
+        vector<vector<Sym>> oldAlts = alts;
+        alts.erase(it);
+        noteMentions(A, rhs, -1);
+        rep.applied = true;
+
+        vector<Sym> firstChanged, followChanged;
+        vector<Sym> seeds = followSeeds(rhs, firstRegion);
+        vector<Sym> followRegion = followRegionOf(seeds);
+        resolveFIRST(A, firstRegion, firstChanged);
+        resolveFOLLOW(seeds, followRegion, followChanged);
+        rebuildRows(A, oldAlts, firstChanged, followChanged, rep);
+        dropUnusedColumns(rhs);
+        return rep;
+    }
+
+    void push(vector<Sym> &work, Sym X) {
+        if (queued[(size_t)X]) return;
+        queued[(size_t)X] = 1;
+        work.push_back(X);
+    }
+
+    Sym pop(vector<Sym> &work) {
+        Sym X = work.back();
+        work.pop_back();
+        queued[(size_t)X] = 0;
+        return X;
+    }
+
+    string describe(const vector<vector<Sym>> &alts, Sym A, int v) const {
+        if (v == ParseTable::NO_RULE) return "";
+        if (v == ParseTable::CONFLICT) return "CONFLICT";
+        return g.name(A) + " -> " + g.rhsToString(alts[(size_t)v]);
+    }
+
+    void noteMentions(Sym B, const vector<Sym> &rhs, int delta) {
+        vector<Sym> seen;
+        for (Sym X : rhs) {
+            if (X == SYM_EPS || find(seen.begin(), seen.end(), X) != seen.end()) continue;
+            seen.push_back(X);
+            auto &m = mentions[(size_t)X];
+            if ((m[B] += delta) == 0) m.erase(B);
+        }
+    }
+
+    bool fitsCurrentColumns(Sym A, const vector<Sym> &rhs) const {
+        if (!g.isNonTerminal(A) || rowOf[(size_t)A] < 0) return false;
+        for (Sym X : rhs)
+            if (X != SYM_EPS && !g.isNonTerminal(X) && ((size_t)X >= colOf.size() || colOf[(size_t)X] < 0)) return false;
+        return true;
+    }
+
+    // A terminal of rhs that no production mentions any more stops being a terminal and
+    // loses its column, as in a full rebuild. No FIRST or FOLLOW can still hold it, so
+    // its cells are already empty and the other cells keep their values.
+    void dropUnusedColumns(const vector<Sym> &rhs) {
+        bool dropped = false;
+        for (Sym X : rhs) {
+            if (!g.isTerminal(X) || !mentions[(size_t)X].empty()) continue;
+            g.termFlag[(size_t)X] = 0;
+            dropped = true;
+        }
+        if (!dropped) return;
+        auto dead = [&](Sym x) { return x != SYM_END && !g.isTerminal(x); };
+        g.terminals.erase(remove_if(g.terminals.begin(), g.terminals.end(), dead), g.terminals.end());
+
+        vector<int> oldCells = move(cells);
+        size_t oldCols = cols.size();
+        vector<int> from; // new column -> old column
+        for (Sym x : cols)
+            if (!dead(x)) from.push_back(colOf[(size_t)x]);
+        for (Sym x : cols)
+            if (dead(x)) colOf[(size_t)x] = -1;
+        cols.erase(remove_if(cols.begin(), cols.end(), dead), cols.end());
+        for (size_t c = 0; c < cols.size(); c++) colOf[(size_t)cols[c]] = (int)c;
+
+        size_t nrows = g.nonterminals.size();
+        cells.assign(nrows * cols.size(), ParseTable::NO_RULE);
+        for (size_t r = 0; r < nrows; r++)
+            for (size_t c = 0; c < cols.size(); c++) cells[r * cols.size() + c] = oldCells[r * oldCols + (size_t)from[c]];
+    }
+
+    void rebuildAll() {
+        FIRST = SymbolSets{};
+        FOLLOW = SymbolSets{};
+        computeFIRST(g, FIRST);
+        computeFOLLOW(g, FIRST, FOLLOW);
+        buildIndex();
+    }
+
+    void buildIndex() {
+        cols = g.terminals;
+        if (!g.isTerminal(SYM_END)) cols.push_back(SYM_END);
+        sort(cols.begin(), cols.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+        rowOf.assign(g.symtab.size(), -1);
+        colOf.assign(g.symtab.size(), -1);
+        for (size_t r = 0; r < g.nonterminals.size(); r++) rowOf[(size_t)g.nonterminals[r]] = (int)r;
+        for (size_t c = 0; c < cols.size(); c++) colOf[(size_t)cols[c]] = (int)c;
+        cells.assign(g.nonterminals.size() * cols.size(), ParseTable::NO_RULE);
+        conflictCells = 0;
+        for (Sym A : g.nonterminals) {
+            int *row = &cells[(size_t)rowOf[(size_t)A] * cols.size()];
+            fillRow(A, row);
+            for (size_t c = 0; c < cols.size(); c++) conflictCells += row[c] == ParseTable::CONFLICT;
+        }
+        mentions.assign(g.symtab.size(), {});
+        for (Sym A : g.nonterminals)
+            for (auto &rhs : g.prod[(size_t)A]) noteMentions(A, rhs, +1);
+        mark.assign(g.symtab.size(), 0);
+        queued.assign(g.symtab.size(), 0);
+        dfn.assign(g.symtab.size(), -1);
+        low.assign(g.symtab.size(), 0);
+        compOf.assign(g.symtab.size(), -1);
+        onStack.assign(g.symtab.size(), 0);
+        stale.assign(g.symtab.size(), 0);
+    }
+
+    // Full rebuild after an edit that changed the symbols; diffs every cell by meaning.
+    void rebuildAfter(const Grammar &before, Sym edited, EditReport &rep) {
+        vector<int> oldRowOf = rowOf, oldColOf = colOf, oldCells = cells;
+        size_t oldCols = cols.size(), oldConflicts = conflictCells;
+        rebuildAll();
+        rep.applied = rep.fullRebuild = true;
+        rep.firstChanged = rep.followChanged = rep.rowsRebuilt = g.nonterminals.size();
+        for (Sym A : g.nonterminals) {
+            for (Sym a : cols) {
+                int now = cell(A, a), old = ParseTable::NO_RULE;
+                if ((size_t)A < oldRowOf.size() && (size_t)a < oldColOf.size() && oldRowOf[(size_t)A] >= 0 && oldColOf[(size_t)a] >= 0)
+                    old = oldCells[(size_t)oldRowOf[(size_t)A] * oldCols + (size_t)oldColOf[(size_t)a]];
+                if (now == old && A != edited) continue;
+                string b = (size_t)A < before.prod.size() ? describe(before.prod[(size_t)A], A, old) : "";
+                string n = describe(A, now);
+                if (b != n) rep.cells.push_back({A, a, b, n});
+            }
+        }
+        rep.newConflicts = conflictCells > oldConflicts ? conflictCells - oldConflicts : 0;
+    }
+
+    // Same placement rules as buildParseTable: a second claim on a cell, even by the
+    // same production, makes it a conflict.
+    void fillRow(Sym A, int *row) const {
+        vector<uint64_t> firstAlpha(FIRST.rowWords());
+        const auto &alts = g.prod[(size_t)A];
+        for (size_t k = 0; k < alts.size(); k++) {
+            firstOfSequence(alts[k], FIRST, g, firstAlpha.data());
+            auto place = [&](Sym t) {
+                int &c = row[colOf[(size_t)t]];
+                c = c == ParseTable::NO_RULE ? (int)k : ParseTable::CONFLICT;
+            };
+            FIRST.forEach(firstAlpha.data(), [&](Sym t) {
+                if (t != SYM_EPS) place(t);
+            });
+            if (firstAlpha[0] & 1) FOLLOW.forEach(FOLLOW.row(A), place);
+        }
+    }
+
+    // FIRST(B) |= FIRST(rhs); true if it grew.
+    bool addFirstOf(Sym B, const vector<Sym> &rhs) {
+        bool changed = false, allEps = true;
+        for (Sym X : rhs) {
+            if (X == SYM_EPS) break;
+            if (!g.isNonTerminal(X)) {
+                changed |= FIRST.add(B, X);
+                allEps = false;
+                break;
+            }
+            changed |= FIRST.unite(FIRST.row(B), FIRST.row(X), false);
+            if (!FIRST.has(X, SYM_EPS)) {
+                allEps = false;
+                break;
+            }
+        }
+        if (allEps) changed |= FIRST.add(B, SYM_EPS);
+        return changed;
+    }
+
+    // X is in the part of rhs that FIRST(rhs) reads (everything before it is nullable).
+    bool firstReads(const vector<Sym> &rhs, Sym X) const {
+        for (Sym Y : rhs) {
+            if (Y == SYM_EPS) return false;
+            if (Y == X) return true;
+            if (!g.isNonTerminal(Y) || !FIRST.has(Y, SYM_EPS)) return false;
+        }
+        return false;
+    }
+
+    void growFIRST(Sym A, vector<Sym> &changed) {
+        stamp++;
+        vector<Sym> work;
+        push(work, A);
+        while (!work.empty()) {
+            Sym B = pop(work);
+            bool grew = false;
+            for (auto &rhs : g.prod[(size_t)B]) grew |= addFirstOf(B, rhs);
+            if (!grew) continue;
+            if (mark[(size_t)B] != stamp) {
+                mark[(size_t)B] = stamp;
+                changed.push_back(B);
+            }
+            for (auto &u : mentions[(size_t)B]) push(work, u.first);
+        }
+    }
+
+    // A and every nonterminal whose FIRST reads one of them, transitively.
+    vector<Sym> firstRegionOf(Sym A) {
+        stamp++;
+        vector<Sym> region{A};
+        mark[(size_t)A] = stamp;
+        for (size_t i = 0; i < region.size(); i++) {
+            Sym X = region[i];
+            for (auto &u : mentions[(size_t)X]) {
+                Sym B = u.first;
+                if (mark[(size_t)B] == stamp) continue;
+                for (auto &rhs : g.prod[(size_t)B]) {
+                    if (!firstReads(rhs, X)) continue;
+                    mark[(size_t)B] = stamp;
+                    region.push_back(B);
+                    break;
+                }
+            }
+        }
+        return region;
+    }
+
+    // Solves `region` again after an edit that can shrink it; rows outside it stay
+    // fixed. Components of the dependency graph (succ(X, f) calls f on each row that
+    // reads X) are taken dependencies first, and one is only cleared and
+    // iterated if it holds a `dirty` member or reads a row that changed, so most of a
+    // large conservative region costs one pass over its edges.
+    template <class Succ, class Eval>
+    void resolveRegion(SymbolSets &sets,
+                       const vector<Sym> &region,
+                       const vector<Sym> &dirty,
+                       Succ &&succ,
+                       Eval &&eval,
+                       vector<Sym> &changed) {
+        stamp++;
+        for (Sym X : region) {
+            mark[(size_t)X] = stamp;
+            dfn[(size_t)X] = -1;
+        }
+
+        // Tarjan, iterative; components come out dependents first.
+        vector<vector<Sym>> comps;
+        vector<Sym> stk;
+        struct Frame {
+            Sym X;
+            vector<Sym> next;
+            size_t i;
+        };
+        vector<Frame> frames;
+        int counter = 0;
+        auto enter = [&](Sym X) {
+            dfn[(size_t)X] = low[(size_t)X] = counter++;
+            stk.push_back(X);
+            onStack[(size_t)X] = 1;
+            frames.push_back({X, {}, 0});
+            succ(X, [&](Sym Y) {
+                if (mark[(size_t)Y] == stamp) frames.back().next.push_back(Y);
+            });
+        };
+        for (Sym root : region) {
+            if (dfn[(size_t)root] >= 0) continue;
+            enter(root);
+            while (!frames.empty()) {
+                Frame &f = frames.back();
+                if (f.i < f.next.size()) {
+                    Sym Y = f.next[f.i++];
+                    if (dfn[(size_t)Y] < 0) enter(Y);
+                    else if (onStack[(size_t)Y]) low[(size_t)f.X] = min(low[(size_t)f.X], dfn[(size_t)Y]);
+                    continue;
+                }
+                Sym X = f.X;
+                frames.pop_back();
+                if (!frames.empty()) low[(size_t)frames.back().X] = min(low[(size_t)frames.back().X], low[(size_t)X]);
+                if (low[(size_t)X] != dfn[(size_t)X]) continue;
+                comps.emplace_back();
+                Sym Y;
+                do {
+                    Y = stk.back();
+                    stk.pop_back();
+                    onStack[(size_t)Y] = 0;
+                    comps.back().push_back(Y);
+                } while (Y != X);
+            }
+        }
+
+        for (size_t c = 0; c < comps.size(); c++)
+            for (Sym X : comps[c]) compOf[(size_t)X] = (int)c;
+
+        const size_t W = sets.rowWords();
+        vector<uint64_t> saved;
+        for (Sym X : dirty) stale[(size_t)X] = 1;
+        for (size_t c = comps.size(); c-- > 0;) {
+            vector<Sym> &comp = comps[c];
+            bool run = false;
+            for (Sym X : comp) run |= stale[(size_t)X] != 0;
+            if (!run) continue;
+            saved.resize(comp.size() * W);
+            for (size_t i = 0; i < comp.size(); i++) {
+                uint64_t *r = sets.row(comp[i]);
+                copy(r, r + W, saved.begin() + (long long)(i * W));
+                fill(r, r + W, 0);
+            }
+            vector<Sym> work;
+            for (Sym X : comp) push(work, X);
+            while (!work.empty()) {
+                Sym X = pop(work);
+                if (!eval(X)) continue;
+                succ(X, [&](Sym Y) {
+                    if (mark[(size_t)Y] == stamp && compOf[(size_t)Y] == (int)c) push(work, Y);
+                });
+            }
+            for (size_t i = 0; i < comp.size(); i++) {
+                Sym X = comp[i];
+                if (equal(sets.row(X), sets.row(X) + W, saved.begin() + (long long)(i * W))) continue;
+                changed.push_back(X);
+                succ(X, [&](Sym Y) {
+                    if (mark[(size_t)Y] == stamp) stale[(size_t)Y] = 1;
+                });
+            }
+        }
+        for (Sym X : region) stale[(size_t)X] = 0;
+    }
+
+    void resolveFIRST(Sym A, const vector<Sym> &region, vector<Sym> &changed) {
+        resolveRegion(
+            FIRST, region, {A},
+            [&](Sym X, auto &&f) {
+                for (auto &u : mentions[(size_t)X]) f(u.first);
+            },
+            [&](Sym B) {
+                bool grew = false;
+                for (auto &rhs : g.prod[(size_t)B]) grew |= addFirstOf(B, rhs);
+                return grew;
+            },
+            changed);
+    }
+
+    // Nonterminals whose FOLLOW gets a constant part from the edited production, or
+    // sits before a changed FIRST with only nullable symbols in between.
+    vector<Sym> followSeeds(const vector<Sym> &rhs, const vector<Sym> &firstChanged) const {
+        vector<Sym> seeds;
+        for (Sym X : rhs)
+            if (g.isNonTerminal(X)) seeds.push_back(X);
+        for (Sym X : firstChanged) {
+            for (auto &u : mentions[(size_t)X]) {
+                for (auto &alt : g.prod[(size_t)u.first]) {
+                    for (size_t i = 0; i < alt.size(); i++) {
+                        if (alt[i] != X) continue;
+                        for (size_t j = i; j-- > 0;) {
+                            if (!g.isNonTerminal(alt[j])) break;
+                            seeds.push_back(alt[j]);
+                            if (!FIRST.has(alt[j], SYM_EPS)) break;
+                        }
+                    }
+                }
+            }
+        }
+        return seeds;
+    }
+
+    // FOLLOW(Y) |= everything its occurrences give it now; true if it grew.
+    bool gatherFollow(Sym Y) {
+        bool grew = false;
+        if (Y == g.start) grew |= FOLLOW.add(Y, SYM_END);
+        vector<uint64_t> firstBeta(FIRST.rowWords());
+        vector<Sym> beta;
+        for (auto &u : mentions[(size_t)Y]) {
+            Sym B = u.first;
+            for (auto &rhs : g.prod[(size_t)B]) {
+                for (size_t i = 0; i < rhs.size(); i++) {
+                    if (rhs[i] != Y) continue;
+                    beta.assign(rhs.begin() + (long long)i + 1, rhs.end());
+                    firstOfSequence(beta, FIRST, g, firstBeta.data());
+                    grew |= FOLLOW.unite(FOLLOW.row(Y), firstBeta.data(), false);
+                    if ((firstBeta[0] & 1) && B != Y) grew |= FOLLOW.unite(FOLLOW.row(Y), FOLLOW.row(B), true);
+                }
+            }
+        }
+        return grew;
+    }
+
+    // Nonterminals Z with FOLLOW(Z) including FOLLOW(Y): Y -> alpha Z beta, beta nullable.
+    template <class F>
+    void followEdges(Sym Y, F &&f) const {
+        for (auto &rhs : g.prod[(size_t)Y]) {
+            for (size_t i = rhs.size(); i-- > 0;) {
+                Sym Z = rhs[i];
+                if (Z == SYM_EPS) continue;
+                if (!g.isNonTerminal(Z)) break;
+                if (Z != Y) f(Z);
+                if (!FIRST.has(Z, SYM_EPS)) break;
+            }
+        }
+    }
+
+    void growFOLLOW(const vector<Sym> &seeds, vector<Sym> &changed) {
+        stamp++;
+        vector<Sym> work;
+        for (Sym Y : seeds) push(work, Y);
+        while (!work.empty()) {
+            Sym Y = pop(work);
+            if (!gatherFollow(Y)) continue;
+            if (mark[(size_t)Y] != stamp) {
+                mark[(size_t)Y] = stamp;
+                changed.push_back(Y);
+            }
+            followEdges(Y, [&](Sym Z) { push(work, Z); });
+        }
+    }
+
+    vector<Sym> followRegionOf(const vector<Sym> &seeds) {
+        stamp++;
+        vector<Sym> region;
+        auto add = [&](Sym Z) {
+            if (mark[(size_t)Z] == stamp) return;
+            mark[(size_t)Z] = stamp;
+            region.push_back(Z);
+        };
+        for (Sym Y : seeds) add(Y);
+        for (size_t i = 0; i < region.size(); i++) followEdges(region[i], add);
+        return region;
+    }
+
+    void resolveFOLLOW(const vector<Sym> &seeds, const vector<Sym> &region, vector<Sym> &changed) {
+        resolveRegion(
+            FOLLOW, region, seeds,
+            [&](Sym Y, auto &&f) { followEdges(Y, f); },
+            [&](Sym Y) { return gatherFollow(Y); },
+            changed);
+    }
+
+    void rebuildRows(Sym edited,
+                     const vector<vector<Sym>> &editedBefore,
+                     const vector<Sym> &firstChanged,
+                     const vector<Sym> &followChanged,
+                     EditReport &rep) {
+        rep.firstChanged = firstChanged.size();
+        rep.followChanged = followChanged.size();
+        stamp++;
+        vector<Sym> rows;
+        auto add = [&](Sym B) {
+            if (mark[(size_t)B] == stamp) return;
+            mark[(size_t)B] = stamp;
+            rows.push_back(B);
+        };
+        add(edited);
+        for (Sym B : followChanged) add(B);
+        for (Sym X : firstChanged) {
+            add(X);
+            for (auto &u : mentions[(size_t)X]) add(u.first);
+        }
+        sort(rows.begin(), rows.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+
+        size_t n = cols.size(), before = conflictCells;
+        vector<int> fresh(n);
+        for (Sym B : rows) {
+            int *row = &cells[(size_t)rowOf[(size_t)B] * n];
+            fill(fresh.begin(), fresh.end(), ParseTable::NO_RULE);
+            fillRow(B, fresh.data());
+            for (size_t c = 0; c < n; c++) {
+                bool same = fresh[c] == row[c];
+                if (same && B != edited) continue;
+                string b = describe(B == edited ? editedBefore : g.prod[(size_t)B], B, row[c]);
+                string a = describe(B, fresh[c]);
+                if (b != a) rep.cells.push_back({B, cols[c], b, a});
+                conflictCells += (fresh[c] == ParseTable::CONFLICT) - (row[c] == ParseTable::CONFLICT);
+                row[c] = fresh[c];
+            }
+        }
+        rep.rowsRebuilt = rows.size();
+        rep.newConflicts = conflictCells > before ? conflictCells - before : 0;
+    }
+
+    EditReport editByName(const string &rule, bool add) {
+        EditReport total;
+        size_t arrow = rule.find("->");
+        string lhs = trim(rule.substr(0, arrow == string::npos ? 0 : arrow));
+        if (arrow == string::npos || lhs.empty()) return total;
+        string rhsAll = rule.substr(arrow + 2);
+        size_t start = 0;
+        while (start <= rhsAll.size()) {
+            size_t bar = rhsAll.find('|', start);
+            string alt = rhsAll.substr(start, bar == string::npos ? string::npos : bar - start);
+            start = bar == string::npos ? rhsAll.size() + 1 : bar + 1;
+
+            Sym A;
+            vector<Sym> rhs;
+            if (add) {
+                A = g.intern(lhs);
+                for (auto &s : tokenizeGrammarSegment(alt)) rhs.push_back(g.intern(s));
+            } else {
+                A = g.symtab.find(lhs);
+                bool known = A >= 0;
+                for (auto &s : tokenizeGrammarSegment(alt)) {
+                    Sym x = g.symtab.find(s);
+                    known &= x >= 0;
+                    rhs.push_back(x);
+                }
+                if (!known) continue;
+            }
+            if (rhs.empty()) rhs.push_back(SYM_EPS);
+            EditReport r = add ? addProduction(A, rhs) : removeProduction(A, rhs);
+            if (!r.applied) continue;
+            total.applied = true;
+            total.fullRebuild |= r.fullRebuild;
+            total.firstChanged += r.firstChanged;
+            total.followChanged += r.followChanged;
+            total.rowsRebuilt += r.rowsRebuilt;
+            total.newConflicts += r.newConflicts;
+            total.cells.insert(total.cells.end(), r.cells.begin(), r.cells.end());
+        }
+        return total;
+    }
+};
+
+// ----------------------------- Lab 09: Predictive Parser -----------------------------
+static vector<string> tokenizeExpressionInput(const string &s) {
+    // Converts input like: id+id*id, a+b*(c) into tokens: id + id * id etc.
+    vector<string> out;
+    for (size_t i = 0; i < s.size();) {
+        char c = s[i];
+        if (isspace((unsigned char)c)) {
+            i++;
+            continue;
+        }
+        if (isalpha((unsigned char)c) || c=='_') {
+            size_t j = i;
+            while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j]=='_')) j++;
+            string word = s.substr(i, j - i);
+            // Treat any identifier as "id" (fits expression grammar)
+            out.push_back("id");
+            i = j;
+            continue;
+        }
         if (isdigit((unsigned char)c)) {
             // treat number as id (for this grammar)
             size_t j = i;
@@ -715,12 +2543,12 @@ static vector<string> tokenizeExpressionInput(const string &s) {
     return out;
 }
 
-static string stackToString(vector<string> st) {
+static string stackToString(const Grammar &g, const vector<Sym> &st) {
     // Print top on right
     string out;
     for (size_t i = 0; i < st.size(); i++) {
         if (i) out += " ";
-        out += st[i];
+        out += g.name(st[i]);
     }
     return out;
 }
@@ -735,14 +2563,18 @@ static string inputToString(const vector<string> &inp, size_t pos) {
 }
 
 static bool predictiveParse(const Grammar &g,
-                            const map<string, map<string, ParseTableCell>> &table,
+                            const ParseTable &table,
                             const string &inputStr,
                             bool showSteps = true) {
     vector<string> inp = tokenizeExpressionInput(inputStr);
+    vector<Sym> in; // -1 for tokens the grammar has never seen
+    for (auto &t : inp) in.push_back(g.symtab.find(t));
     size_t ip = 0;
+    PhaseScope stats(Phase::PredictiveParse);
+    stats.add(STAT_TOKENS, in.size());
 
-    vector<string> st;
-    st.push_back(END_MARK);
+    vector<Sym> st;
+    st.push_back(SYM_END);
     st.push_back(g.start);
 
     if (showSteps) {
@@ -752,135 +2584,1366 @@ static bool predictiveParse(const Grammar &g,
     }
 
     while (!st.empty()) {
-        string X = st.back();
-        string a = (ip < inp.size() ? inp[ip] : END_MARK);
+        stats.add(STAT_STEPS);
+        Sym X = st.back();
+        Sym a = (ip < in.size() ? in[ip] : SYM_END);
+        const string &aName = (ip < inp.size() ? inp[ip] : END_MARK);
 
         if (showSteps) {
-            cout << left << setw(30) << stackToString(st)
+            cout << left << setw(30) << stackToString(g, st)
                  << setw(35) << inputToString(inp, ip);
         }
 
-        if (X == END_MARK && a == END_MARK) {
+        if (X == SYM_END && a == SYM_END) {
             if (showSteps) cout << "ACCEPT\n";
             return true;
         }
 
-        if (!g.isNonTerminal(X) || X == END_MARK) {
+        if (!g.isNonTerminal(X) || X == SYM_END) {
             // terminal
             if (X == a) {
                 st.pop_back();
                 ip++;
-                if (showSteps) cout << "match " << a << "\n";
+                if (showSteps) cout << "match " << aName << "\n";
             } else {
-                if (showSteps) cout << "ERROR (expected " << X << ")\n";
+                if (showSteps) cout << "ERROR (expected " << g.name(X) << ")\n";
                 return false;
             }
         } else {
             // nonterminal
-            auto rowIt = table.find(X);
-            if (rowIt == table.end()) {
-                if (showSteps) cout << "ERROR (no table row)\n";
-                return false;
-            }
-            auto colIt = rowIt->second.find(a);
-            if (colIt == rowIt->second.end() || !colIt->second.filled || colIt->second.conflict) {
-                if (showSteps) cout << "ERROR (no rule for [" << X << "," << a << "])\n";
+            int p = table.lookup(X, a);
+            if (p < 0) {
+                if (showSteps) cout << "ERROR (no rule for [" << g.name(X) << "," << aName << "])\n";
                 return false;
             }
 
-            vector<string> rhs = colIt->second.rhs;
+            const vector<Sym> &rhs = table.prodRhs[(size_t)p];
             st.pop_back();
 
             // push RHS in reverse (skip eps)
-            if (!(rhs.size() == 1 && rhs[0] == EPS)) {
+            if (!(rhs.size() == 1 && rhs[0] == SYM_EPS)) {
                 for (auto it = rhs.rbegin(); it != rhs.rend(); ++it) {
                     st.push_back(*it);
                 }
             }
-            if (showSteps) cout << X << " -> " << joinSymbols(rhs) << "\n";
+            if (showSteps) cout << g.name(X) << " -> " << g.rhsToString(rhs) << "\n";
         }
     }
 
     return false;
 }
 
-// ----------------------------- Lab 01: Comment Removal -----------------------------
-static string removeCComments(const string &code) {
-    string out;
-    bool inString = false, inChar = false;
-    bool inSL = false, inML = false;
-    bool esc = false;
+// Streaming form of tokenizeExpressionInput: bytes can arrive in pieces of any size
+// and each token is emitted as a symbol id as soon as it starts (identifiers and
+// numbers all become "id", so their length never matters). The only state carried
+// between pieces is whether a word or number is still running.
+class ExprTokenizer {
+public:
+    explicit ExprTokenizer(const Grammar &g) {
+        idSym = g.symtab.find("id");
+        for (int c = 0; c < 256; c++) charSym[(size_t)c] = g.symtab.find(string(1, (char)c));
+    }
 
-    for (size_t i = 0; i < code.size(); i++) {
-        char c = code[i];
-        char n = (i + 1 < code.size() ? code[i + 1] : '\0');
+    void reset() { state = NONE; }
 
-        if (inSL) {
-            if (c == '\n') {
-                inSL = false;
-                out.push_back(c);
+    template <class Emit>
+    void feed(const char *p, size_t n, Emit &&emit) {
+        const char *e = p + n;
+        while (p < e) {
+            if (state == WORD) {
+                while (p < e && (isalnum((unsigned char)*p) || *p == '_')) p++;
+            } else if (state == NUMBER) {
+                while (p < e && (isdigit((unsigned char)*p) || *p == '.')) p++;
             }
-            continue;
-        }
-
-        if (inML) {
-            if (c == '*' && n == '/') {
-                inML = false;
-                i++;
+            if (p == e) return;
+            state = NONE;
+
+            unsigned char c = (unsigned char)*p++;
+            if (isspace(c)) continue;
+            if (isalpha(c) || c == '_') {
+                state = WORD;
+                emit(idSym);
+            } else if (isdigit(c)) {
+                state = NUMBER;
+                emit(idSym);
+            } else {
+                emit(charSym[c]);
             }
-            continue;
         }
+    }
 
-        if (inString) {
-            out.push_back(c);
-            if (!esc && c == '"') inString = false;
-            esc = (!esc && c == '\\');
-            continue;
-        }
+private:
+    enum { NONE, WORD, NUMBER } state = NONE;
+    Sym idSym;
+    array<Sym, 256> charSym;
+};
 
-        if (inChar) {
-            out.push_back(c);
-            if (!esc && c == '\'') inChar = false;
-            esc = (!esc && c == '\\');
-            continue;
-        }
+// Quiet fast path for validating many inputs: integer symbols only, and the token
+// and stack buffers are reused, so once they have grown a parse allocates nothing.
+// Accepts the same strings as predictiveParse.
+class QuietParser {
+public:
+    QuietParser(const Grammar &g, const ParseTable &table) : table(table), start(g.start), lexer(g) {
+        in.reserve(1024);
+        stack.reserve(1024);
+    }
 
-        // not inside string/char/comment
-        if (c == '"' ) {
-            inString = true;
-            esc = false;
-            out.push_back(c);
-            continue;
-        }
-        if (c == '\'') {
-            inChar = true;
-            esc = false;
-            out.push_back(c);
-            continue;
-        }
+    // Number of tokens (without $) in the last input.
+    size_t lastTokens() const { return in.empty() ? 0 : in.size() - 1; }
 
-        // comment starts?
-        if (c == '/' && n == '/') {
-            inSL = true;
-            i++;
-            continue;
-        }
-        if (c == '/' && n == '*') {
-            inML = true;
-            i++;
-            continue;
+    bool parse(string_view s) {
+        in.clear();
+        lexer.reset();
+        lexer.feed(s.data(), s.size(), [this](Sym t) { in.push_back(t); });
+        in.push_back(SYM_END);
+        return run();
+    }
+
+private:
+    const ParseTable &table;
+    Sym start;
+    ExprTokenizer lexer;
+    vector<Sym> in, stack;
+
+    bool run() {
+        if (start < 0) return false;
+        stack.clear();
+        stack.push_back(SYM_END);
+        stack.push_back(start);
+        const Sym *ip = in.data();
+        while (true) {
+            Sym X = stack.back(), a = *ip;
+            if (table.rowOf[(size_t)X] < 0) {
+                if (X != a) return false;
+                if (X == SYM_END) return true;
+                stack.pop_back();
+                ip++;
+                continue;
+            }
+            int p = table.lookup(X, a);
+            if (p < 0) return false;
+            stack.pop_back();
+            stack.insert(stack.end(),
+                         table.pushSyms.begin() + table.pushBegin[(size_t)p],
+                         table.pushSyms.begin() + table.pushBegin[(size_t)p + 1]);
         }
+    }
+};
 
-        out.push_back(c);
+// Resumable LL(1) parser: tokens are pushed one at a time and only the parse stack
+// is kept between calls, so input of any length (or arriving from a pipe) is checked
+// in memory proportional to its nesting depth. The outcome is decided as early as
+// possible and stays fixed afterwards.
+class PushParser {
+public:
+    enum Status { MORE, ACCEPTED, REJECTED };
+
+    PushParser(const Grammar &g, const ParseTable &table) : table(table), start(g.start) {
+        stack.reserve(1024);
+        reset();
     }
-    return out;
-}
 
-// ----------------------------- Lab 02: Tokenizer (simple C-like) -----------------------------
-enum class TokType {
-    KEYWORD, IDENTIFIER, NUMBER, STRING_LIT, CHAR_LIT,
-    OPERATOR, SEPARATOR, PREPROCESSOR, UNKNOWN
-};
+    void reset() {
+        stack.clear();
+        stack.push_back(SYM_END);
+        if (start >= 0) stack.push_back(start);
+        result = start >= 0 ? MORE : REJECTED;
+        consumed = 0;
+        maxDepth = stack.size();
+    }
+
+    Status feed(Sym a) {
+        while (result == MORE) {
+            Sym X = stack.back();
+            if (table.rowOf[(size_t)X] < 0) {
+                if (X != a) return result = REJECTED;
+                if (X == SYM_END) return result = ACCEPTED;
+                stack.pop_back();
+                consumed++;
+                return MORE;
+            }
+            int p = table.lookup(X, a);
+            if (p < 0) return result = REJECTED;
+            stack.pop_back();
+            stack.insert(stack.end(),
+                         table.pushSyms.begin() + table.pushBegin[(size_t)p],
+                         table.pushSyms.begin() + table.pushBegin[(size_t)p + 1]);
+            maxDepth = max(maxDepth, stack.size());
+        }
+        return result;
+    }
+
+    Status finish() { return feed(SYM_END); }
+
+    Status status() const { return result; }
+    size_t tokensConsumed() const { return consumed; }
+    size_t maxStackDepth() const { return maxDepth; }
+
+private:
+    const ParseTable &table;
+    Sym start;
+    vector<Sym> stack;
+    Status result = MORE;
+    size_t consumed = 0, maxDepth = 0;
+};
+
+struct StreamParseResult {
+    PushParser::Status status = PushParser::MORE;
+    size_t bytes = 0, tokens = 0, maxDepth = 0;
+    double seconds = 0;
+};
+
+// Treats the whole stream as one expression; reads fixed-size pieces and stops early
+// once the outcome is known.
+static StreamParseResult parseExpressionStream(const Grammar &g,
+                                               const ParseTable &table,
+                                               istream &in,
+                                               size_t chunk = 1u << 16) {
+    StreamParseResult r;
+    auto t0 = chrono::steady_clock::now();
+    ExprTokenizer lexer(g);
+    PushParser parser(g, table);
+    vector<char> buf(chunk);
+    while (parser.status() == PushParser::MORE && in) {
+        in.read(buf.data(), (streamsize)buf.size());
+        size_t n = (size_t)in.gcount();
+        if (n == 0) break;
+        r.bytes += n;
+        lexer.feed(buf.data(), n, [&](Sym t) { parser.feed(t); });
+    }
+    r.status = parser.finish();
+    r.tokens = parser.tokensConsumed();
+    r.maxDepth = parser.maxStackDepth();
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return r;
+}
+
+static void printStreamParseResult(const StreamParseResult &r) {
+    cout << "\n--- Streaming Parse ---\n";
+    cout << "RESULT: " << (r.status == PushParser::ACCEPTED ? "String ACCEPTED" : "String REJECTED");
+    if (r.status != PushParser::ACCEPTED) cout << " (after " << r.tokens << " matched tokens)";
+    cout << "\nBytes read: " << r.bytes << "\n";
+    cout << "Tokens matched: " << r.tokens << "\n";
+    cout << "Max stack depth: " << r.maxDepth << "\n";
+    cout << fixed << setprecision(3) << "Time: " << r.seconds << " s\n";
+    double s = r.seconds > 0 ? r.seconds : 1e-9;
+    cout << setprecision(1) << "Throughput: " << r.tokens / 1e6 / s << " Mtokens/s, " << r.bytes / 1e6 / s
+         << " MB/s\n";
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+// Concrete parse tree kept in two arenas: nodes in one vector (a node's children are
+// allocated together, so they are found by index and count) and lexemes copied into
+// one string. Nothing points into the input, and reset() frees a tree of any size
+// at once while keeping the capacity for the next parse.
+struct ParseTree {
+    struct Node {
+        Sym sym;
+        int firstChild = -1;
+        int childCount = 0;
+        uint32_t lexBegin = 0, lexLen = 0; // into text, terminals only
+    };
+
+    vector<Node> nodes;
+    string text;
+    int root = -1;
+
+    void reset() {
+        nodes.clear();
+        text.clear();
+        root = -1;
+    }
+
+    string_view lexeme(int n) const {
+        return string_view(text).substr(nodes[(size_t)n].lexBegin, nodes[(size_t)n].lexLen);
+    }
+
+    size_t arenaBytes() const { return nodes.capacity() * sizeof(Node) + text.capacity(); }
+
+    void print(const Grammar &g, ostream &out) const {
+        vector<pair<int, int>> todo; // (node, depth)
+        if (root >= 0) todo.push_back({root, 0});
+        while (!todo.empty()) {
+            auto [n, depth] = todo.back();
+            todo.pop_back();
+            const Node &nd = nodes[(size_t)n];
+            out << string((size_t)depth * 2, ' ') << g.name(nd.sym);
+            if (nd.lexLen) out << "  \"" << lexeme(n) << "\"";
+            out << "\n";
+            for (int c = nd.childCount - 1; c >= 0; c--) todo.push_back({nd.firstChild + c, depth + 1});
+        }
+    }
+};
+
+// End of the expression token starting at s[i] (same rules as tokenizeExpressionInput).
+static size_t exprTokenEnd(string_view s, size_t i) {
+    unsigned char c = (unsigned char)s[i];
+    size_t j = i + 1;
+    if (isalpha(c) || c == '_') {
+        while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_')) j++;
+    } else if (isdigit(c)) {
+        while (j < s.size() && (isdigit((unsigned char)s[j]) || s[j] == '.')) j++;
+    }
+    return j;
+}
+
+// Runs the LL(1) loop over input and grows tree alongside it: every expansion
+// allocates the production's children in one block, and every match stores the
+// original lexeme in the leaf. Returns false on a syntax error (tree is then partial).
+static bool buildParseTree(const Grammar &g, const ParseTable &table, string_view input, ParseTree &tree) {
+    tree.reset();
+    if (g.start < 0) return false;
+
+    struct Tok {
+        Sym sym;
+        size_t begin, len;
+    };
+    vector<Tok> in;
+    Sym idSym = g.symtab.find("id");
+    for (size_t i = 0; i < input.size();) {
+        if (isspace((unsigned char)input[i])) {
+            i++;
+            continue;
+        }
+        size_t j = exprTokenEnd(input, i);
+        unsigned char c = (unsigned char)input[i];
+        Sym t = (isalnum(c) || c == '_') ? idSym : g.symtab.find(input.substr(i, 1));
+        in.push_back({t, i, j - i});
+        i = j;
+    }
+    in.push_back({SYM_END, input.size(), 0});
+
+    tree.root = 0;
+    tree.nodes.push_back(ParseTree::Node{g.start});
+    vector<pair<Sym, int>> st{{SYM_END, -1}, {g.start, 0}};
+    size_t ip = 0;
+    while (true) {
+        auto [X, node] = st.back();
+        const Tok &a = in[ip];
+        if (table.rowOf[(size_t)X] < 0) {
+            if (X != a.sym) return false;
+            if (X == SYM_END) return true;
+            auto &leaf = tree.nodes[(size_t)node];
+            leaf.lexBegin = (uint32_t)tree.text.size();
+            leaf.lexLen = (uint32_t)a.len;
+            tree.text.append(input.substr(a.begin, a.len));
+            st.pop_back();
+            ip++;
+            continue;
+        }
+        int p = table.lookup(X, a.sym);
+        if (p < 0) return false;
+        st.pop_back();
+
+        const vector<Sym> &rhs = table.prodRhs[(size_t)p];
+        int first = (int)tree.nodes.size();
+        tree.nodes[(size_t)node].firstChild = first;
+        tree.nodes[(size_t)node].childCount = (int)rhs.size();
+        for (Sym Y : rhs) tree.nodes.push_back(ParseTree::Node{Y});
+        for (int k = (int)rhs.size() - 1; k >= 0; k--)
+            if (rhs[(size_t)k] != SYM_EPS) st.push_back({rhs[(size_t)k], first + k});
+    }
+}
+
+struct ParseRunStats {
+    size_t lines = 0, accepted = 0, rejected = 0, tokens = 0, bytes = 0;
+    size_t physicalLines = 0;     // including blank ones
+    vector<size_t> firstFailures; // line numbers, ascending
+    unsigned threads = 1;
+    double seconds = 0;
+};
+
+static const size_t MAX_REPORTED_FAILURES = 10;
+
+// Parses every non-blank line of text as one input. Failing lines are numbered from
+// firstLine; only the first MAX_REPORTED_FAILURES are kept.
+static void parseLineRange(QuietParser &parser, string_view text, size_t firstLine, ParseRunStats &st) {
+    st.bytes += text.size();
+    size_t pos = 0, lineNo = firstLine;
+    while (pos < text.size()) {
+        const void *nl = memchr(text.data() + pos, '\n', text.size() - pos);
+        size_t end = nl ? (size_t)((const char *)nl - text.data()) : text.size();
+        string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        size_t here = lineNo++;
+        st.physicalLines++;
+        if (all_of(line.begin(), line.end(), [](char c) { return isspace((unsigned char)c); })) continue;
+
+        st.lines++;
+        if (parser.parse(line)) {
+            st.accepted++;
+        } else {
+            st.rejected++;
+            if (st.firstFailures.size() < MAX_REPORTED_FAILURES) st.firstFailures.push_back(here);
+        }
+        st.tokens += parser.lastTokens();
+    }
+}
+
+static void printParseRunStats(const ParseRunStats &st) {
+    cout << "\n--- Quiet Parse ---\n";
+    cout << "Inputs: " << st.lines << " (" << st.accepted << " accepted, " << st.rejected << " rejected)\n";
+    if (!st.firstFailures.empty()) {
+        cout << "First failing lines:";
+        for (size_t ln : st.firstFailures) cout << " " << ln;
+        cout << (st.rejected > st.firstFailures.size() ? " ..." : "") << "\n";
+    }
+    cout << "Tokens: " << st.tokens << "\n";
+    cout << "Threads: " << st.threads << "\n";
+    cout << fixed << setprecision(3) << "Time: " << st.seconds << " s\n";
+    double s = st.seconds > 0 ? st.seconds : 1e-9;
+    cout << setprecision(1) << "Throughput: " << st.tokens / 1e6 / s << " Mtokens/s, " << st.bytes / 1e6 / s
+         << " MB/s\n";
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+// Builds the preprocessed expression grammar and its table (the Case 07 parser).
+// Only the interactive menu uses the cache; command-line runs leave the working
+// directory alone.
+static void buildExprParser(Grammar &g, ParseTable &table, bool useCache = false) {
+    GrammarAnalysis an;
+    if (useCache) analyseGrammarCached(defaultExprGrammarLeftRecursive(), true, an);
+    else analyseGrammar(defaultExprGrammarLeftRecursive(), true, an);
+    g = move(an.g);
+    table = move(an.table);
+}
+
+// ----------------------------- Lab 10: LR Parsing (SLR(1) / LALR(1)) -----------------------------
+// Bottom-up tables, so left-recursive and other non-LL(1) grammars can be parsed as
+// they are, without rewriting. Production 0 is the augmented S' -> S; the rest follow
+// g.nonterminals order with eps dropped from the right-hand side. Item (p, dot) has
+// the id itemBase[p] + dot.
+enum class LRMode { SLR, LALR };
+
+struct LRTable {
+    // Encoded actions: 0 = error, s + 1 = shift to state s, -(p + 1) = reduce by p.
+    // Reducing by production 0 means accept.
+    static constexpr int ERROR = 0;
+    static int shift(int s) { return s + 1; }
+    static int reduce(int p) { return -p - 1; }
+
+    struct Conflict {
+        int state;
+        Sym terminal;
+        int kept, dropped; // encoded actions; shift wins, then the earlier production
+    };
+
+    LRMode mode = LRMode::LALR;
+    vector<Sym> prodLhs;         // production -> A (-1 for production 0)
+    vector<vector<Sym>> prodRhs; // production -> alpha, eps dropped
+    vector<int> itemBase;        // production -> id of its first item
+    vector<int> kernelBegin;     // state s: kernelItems[kernelBegin[s] .. kernelBegin[s + 1])
+    vector<int> kernelItems;
+
+    vector<int> colOf;         // Sym -> ACTION column (terminals and $), -1 otherwise
+    vector<int> ntOf;          // Sym -> GOTO row (nonterminals), -1 otherwise
+    // ACTION rows are states. Each state's most common reduction becomes its default,
+    // and only the other entries are packed (row displacement, as for LL(1)).
+    vector<int> actionBase, defaultAction;
+    vector<ParseTable::Slot> actionSlots;
+    // GOTO rows are nonterminals, columns states. A goto is only ever asked for where
+    // one exists, so each nonterminal's most common target needs no entry either.
+    vector<int> gotoBase, defaultGoto;
+    vector<ParseTable::Slot> gotoSlots;
+
+    vector<Conflict> conflicts;
+    size_t lookaheadUnions = 0;
+
+    size_t states() const { return kernelBegin.empty() ? 0 : kernelBegin.size() - 1; }
+
+    // Packed entry only (ERROR if none), i.e. without the state's default.
+    int explicitAction(int s, Sym a) const {
+        if ((size_t)a >= colOf.size() || colOf[(size_t)a] < 0) return ERROR;
+        const ParseTable::Slot &e = actionSlots[(size_t)(actionBase[(size_t)s] + colOf[(size_t)a])];
+        return e.owner == s ? e.prod : ERROR;
+    }
+
+    int action(int s, Sym a) const {
+        if ((size_t)a >= colOf.size() || colOf[(size_t)a] < 0) return ERROR;
+        int v = explicitAction(s, a);
+        return v != ERROR ? v : defaultAction[(size_t)s];
+    }
+
+    int go(int s, Sym A) const {
+        int r = ntOf[(size_t)A];
+        const ParseTable::Slot &e = gotoSlots[(size_t)(gotoBase[(size_t)r] + s)];
+        return e.owner == r ? e.prod : defaultGoto[(size_t)r];
+    }
+};
+
+// LR(0) automaton, then SLR(1) lookaheads from FOLLOW or LALR(1) lookaheads by
+// DeRemer-Pennello: Read = DR closed over "reads", Follow = Read closed over
+// "includes" (both with digraphClosure), LA(q, A -> w) = union of Follow(p, A) over
+// its lookback transitions. Kernels are sorted item-id lists found through an FNV
+// hash; closures are item lists with a per-state stamp on each nonterminal already
+// expanded, and lookaheads are bitsets.
+static void buildLRTable(const Grammar &g, LRMode mode, LRTable &t) {
+    PhaseScope stats(Phase::LRTable);
+    t = LRTable{};
+    t.mode = mode;
+
+    vector<vector<int>> prodsOf(g.symtab.size());
+    t.prodLhs.push_back(-1);
+    t.prodRhs.push_back({g.start});
+    for (Sym A : g.nonterminals) {
+        for (auto &rhs : g.prod[(size_t)A]) {
+            prodsOf[(size_t)A].push_back((int)t.prodLhs.size());
+            t.prodLhs.push_back(A);
+            vector<Sym> body;
+            for (Sym X : rhs)
+                if (X != SYM_EPS) body.push_back(X);
+            t.prodRhs.push_back(move(body));
+        }
+    }
+    vector<int> itemProd;
+    for (size_t p = 0; p < t.prodRhs.size(); p++) {
+        t.itemBase.push_back((int)itemProd.size());
+        itemProd.insert(itemProd.end(), t.prodRhs[p].size() + 1, (int)p);
+    }
+    auto symAfter = [&](int it) -> Sym {
+        int p = itemProd[(size_t)it];
+        size_t dot = (size_t)(it - t.itemBase[(size_t)p]);
+        return dot < t.prodRhs[(size_t)p].size() ? t.prodRhs[(size_t)p][dot] : -1;
+    };
+
+    // ---- LR(0) item sets ----
+    struct Edge {
+        Sym X;
+        int to;
+        int nt; // index among nonterminal transitions, -1 for terminals
+    };
+    vector<vector<Edge>> edges;
+    vector<vector<int>> reductions; // state -> productions with a complete item
+    unordered_map<uint64_t, int> firstWithHash;
+    vector<int> nextWithHash;
+    t.kernelBegin.push_back(0);
+
+    auto addState = [&](const vector<int> &kernel) {
+        uint64_t h = 1469598103934665603ull;
+        for (int it : kernel) h = (h ^ (uint64_t)it) * 1099511628211ull;
+        auto slot = firstWithHash.find(h);
+        for (int s = slot == firstWithHash.end() ? -1 : slot->second; s >= 0; s = nextWithHash[(size_t)s]) {
+            int b = t.kernelBegin[(size_t)s], e = t.kernelBegin[(size_t)s + 1];
+            if ((size_t)(e - b) == kernel.size() && equal(kernel.begin(), kernel.end(), t.kernelItems.begin() + b))
+                return s;
+        }
+        int s = (int)t.states();
+        nextWithHash.push_back(slot == firstWithHash.end() ? -1 : slot->second);
+        firstWithHash[h] = s;
+        t.kernelItems.insert(t.kernelItems.end(), kernel.begin(), kernel.end());
+        t.kernelBegin.push_back((int)t.kernelItems.size());
+        return s;
+    };
+    addState({t.itemBase[0]});
+
+    vector<int> ntMark(g.symtab.size(), -1), closure, kernel;
+    vector<Sym> pending, touched;
+    vector<vector<int>> bucket(g.symtab.size()); // X -> kernel of goto(state, X)
+    for (size_t s = 0; s < t.states(); s++) {
+        closure.assign(t.kernelItems.begin() + t.kernelBegin[s], t.kernelItems.begin() + t.kernelBegin[s + 1]);
+        auto want = [&](Sym X) {
+            if (X < 0 || !g.isNonTerminal(X) || ntMark[(size_t)X] == (int)s) return;
+            ntMark[(size_t)X] = (int)s;
+            pending.push_back(X);
+        };
+        for (int it : closure) want(symAfter(it));
+        while (!pending.empty()) {
+            Sym B = pending.back();
+            pending.pop_back();
+            for (int p : prodsOf[(size_t)B]) {
+                closure.push_back(t.itemBase[(size_t)p]);
+                if (!t.prodRhs[(size_t)p].empty()) want(t.prodRhs[(size_t)p][0]);
+            }
+        }
+
+        reductions.emplace_back();
+        for (int it : closure) {
+            Sym X = symAfter(it);
+            if (X < 0) {
+                reductions[s].push_back(itemProd[(size_t)it]);
+                continue;
+            }
+            if (bucket[(size_t)X].empty()) touched.push_back(X);
+            bucket[(size_t)X].push_back(it + 1);
+        }
+        vector<Edge> out;
+        for (Sym X : touched) {
+            kernel.swap(bucket[(size_t)X]);
+            sort(kernel.begin(), kernel.end());
+            out.push_back({X, addState(kernel), -1});
+            kernel.clear();
+        }
+        touched.clear();
+        sort(out.begin(), out.end(), [](const Edge &x, const Edge &y) { return x.X < y.X; });
+        edges.push_back(move(out));
+    }
+    const size_t states = t.states();
+    auto edgeOf = [&](int s, Sym X) -> Edge & {
+        auto &es = edges[(size_t)s];
+        return *lower_bound(es.begin(), es.end(), X, [](const Edge &e, Sym x) { return e.X < x; });
+    };
+
+    // ---- columns ----
+    vector<Sym> cols = g.terminals;
+    if (!g.isTerminal(SYM_END)) cols.push_back(SYM_END);
+    t.colOf.assign(g.symtab.size(), -1);
+    t.ntOf.assign(g.symtab.size(), -1);
+    for (size_t c = 0; c < cols.size(); c++) t.colOf[(size_t)cols[c]] = (int)c;
+    for (size_t r = 0; r < g.nonterminals.size(); r++) t.ntOf[(size_t)g.nonterminals[r]] = (int)r;
+
+    // ---- lookaheads: (state, production) -> terminals ----
+    vector<vector<pair<int, const uint64_t *>>> lookahead(states); // state -> (production, set row)
+    SymbolSets FIRST, FOLLOW, LA, reduceLA;
+    if (mode == LRMode::SLR) {
+        computeFIRST(g, FIRST);
+        computeFOLLOW(g, FIRST, FOLLOW);
+        for (size_t s = 0; s < states; s++)
+            for (int p : reductions[s])
+                if (p != 0) lookahead[s].push_back({p, FOLLOW.row(t.prodLhs[(size_t)p])});
+    } else {
+        vector<char> nullable = computeNullable(g);
+        vector<pair<int, Sym>> ntTrans; // (state, A)
+        for (size_t s = 0; s < states; s++) {
+            for (Edge &e : edges[s]) {
+                if (!g.isNonTerminal(e.X)) continue;
+                e.nt = (int)ntTrans.size();
+                ntTrans.push_back({(int)s, e.X});
+            }
+        }
+        LA.init(g, ntTrans.size());
+        vector<Sym> nodes(ntTrans.size());
+        iota(nodes.begin(), nodes.end(), 0);
+
+        // DR(p, A): terminals shifted right after the transition; reads: nullable
+        // nonterminal transitions right after it.
+        vector<vector<Sym>> R(ntTrans.size());
+        for (size_t i = 0; i < ntTrans.size(); i++) {
+            int r = edgeOf(ntTrans[i].first, ntTrans[i].second).to;
+            if (ntTrans[i].first == 0 && ntTrans[i].second == g.start) LA.add((Sym)i, SYM_END);
+            for (const Edge &e : edges[(size_t)r]) {
+                if (!g.isNonTerminal(e.X)) LA.add((Sym)i, e.X);
+                else if (nullable[(size_t)e.X]) R[i].push_back(e.nt);
+            }
+        }
+        t.lookaheadUnions += digraphClosure(nodes, R, LA);
+
+        // (q, A) includes (p, B) for B -> beta A gamma, gamma nullable, p --beta--> q.
+        // Walking each production from p also finds its lookback: (end, prod) -> (p, B).
+        for (auto &r : R) r.clear();
+        vector<int> reduceBase{0}; // state s: reductions reduceBase[s] + k
+        for (size_t st = 0; st < states; st++) reduceBase.push_back(reduceBase.back() + (int)reductions[st].size());
+        vector<pair<int, int>> lookback; // (reduction, transition)
+        for (size_t i = 0; i < ntTrans.size(); i++) {
+            for (int p : prodsOf[(size_t)ntTrans[i].second]) {
+                const vector<Sym> &rhs = t.prodRhs[(size_t)p];
+                size_t nullableFrom = rhs.size(); // rhs[k..] is nullable for k >= nullableFrom
+                while (nullableFrom > 0 && g.isNonTerminal(rhs[nullableFrom - 1]) && nullable[(size_t)rhs[nullableFrom - 1]])
+                    nullableFrom--;
+                int q = ntTrans[i].first;
+                for (size_t k = 0; k < rhs.size(); k++) {
+                    Edge &e = edgeOf(q, rhs[k]);
+                    if (e.nt >= 0 && k + 1 >= nullableFrom) R[(size_t)e.nt].push_back((Sym)i);
+                    q = e.to;
+                }
+                auto &red = reductions[(size_t)q];
+                int k = (int)(find(red.begin(), red.end(), p) - red.begin());
+                lookback.push_back({reduceBase[(size_t)q] + k, (int)i});
+            }
+        }
+        t.lookaheadUnions += digraphClosure(nodes, R, LA);
+
+        // A reduction can have several lookback transitions; merge them first.
+        reduceLA.init(g, (size_t)reduceBase.back());
+        for (auto &lb : lookback) reduceLA.unite(reduceLA.row((Sym)lb.first), LA.row((Sym)lb.second), true);
+        for (size_t s = 0; s < states; s++)
+            for (size_t k = 0; k < reductions[s].size(); k++)
+                if (reductions[s][k] != 0)
+                    lookahead[s].push_back({reductions[s][k], reduceLA.row((Sym)(reduceBase[s] + (int)k))});
+    }
+    stats.add(STAT_ITERATIONS, t.lookaheadUnions);
+    stats.add(STAT_STATES, states);
+
+    // ---- ACTION ----
+    const SymbolSets &sets = mode == LRMode::SLR ? FOLLOW : reduceLA;
+    vector<vector<pair<int, int>>> actionRows(states);
+    vector<int> row(cols.size(), LRTable::ERROR), used, reduceCount(t.prodRhs.size(), 0);
+    t.defaultAction.assign(states, LRTable::ERROR);
+    for (size_t s = 0; s < states; s++) {
+        auto place = [&](Sym a, int act) {
+            int &cell = row[(size_t)t.colOf[(size_t)a]];
+            if (cell == LRTable::ERROR) {
+                cell = act;
+                used.push_back(t.colOf[(size_t)a]);
+            } else if (cell != act) {
+                int keep = max(cell, act); // shift > reduce(earlier) > reduce(later)
+                t.conflicts.push_back({(int)s, a, keep, min(cell, act)});
+                cell = keep;
+            }
+        };
+        for (const Edge &e : edges[s])
+            if (!g.isNonTerminal(e.X)) place(e.X, LRTable::shift(e.to));
+        for (int p : reductions[s])
+            if (p == 0) place(SYM_END, LRTable::reduce(0));
+        for (auto &la : lookahead[s])
+            sets.forEach(la.second, [&](Sym a) {
+                if (a != SYM_EPS) place(a, LRTable::reduce(la.first));
+            });
+
+        int best = LRTable::ERROR, bestCount = 0;
+        for (int c : used) {
+            int v = row[(size_t)c];
+            if (v >= LRTable::reduce(0)) continue; // shifts and accept stay explicit
+            int n = ++reduceCount[(size_t)(-v - 1)];
+            if (n > bestCount) {
+                best = v;
+                bestCount = n;
+            }
+        }
+        t.defaultAction[s] = best;
+        sort(used.begin(), used.end());
+        for (int c : used) {
+            int v = row[(size_t)c];
+            if (v < LRTable::reduce(0)) reduceCount[(size_t)(-v - 1)] = 0;
+            if (v != best) actionRows[s].push_back({c, v});
+            row[(size_t)c] = LRTable::ERROR;
+        }
+        used.clear();
+    }
+    packRows(actionRows, cols.size(), t.actionBase, t.actionSlots);
+    stats.add(STAT_CONFLICTS, t.conflicts.size());
+
+    // ---- GOTO ----
+    vector<vector<pair<int, int>>> gotoRows(g.nonterminals.size());
+    for (size_t s = 0; s < states; s++)
+        for (const Edge &e : edges[s])
+            if (g.isNonTerminal(e.X)) gotoRows[(size_t)t.ntOf[(size_t)e.X]].push_back({(int)s, e.to});
+    t.defaultGoto.assign(g.nonterminals.size(), -1);
+    unordered_map<int, int> targetCount;
+    for (size_t r = 0; r < gotoRows.size(); r++) {
+        targetCount.clear();
+        int bestCount = 0;
+        for (auto &e : gotoRows[r]) {
+            int n = ++targetCount[e.second];
+            if (n > bestCount) {
+                t.defaultGoto[r] = e.second;
+                bestCount = n;
+            }
+        }
+        auto &gr = gotoRows[r];
+        gr.erase(remove_if(gr.begin(), gr.end(), [&](const pair<int, int> &e) { return e.second == t.defaultGoto[r]; }),
+                 gr.end());
+    }
+    packRows(gotoRows, states, t.gotoBase, t.gotoSlots);
+}
+
+static string lrLhsName(const Grammar &g, const LRTable &t, int p) {
+    return p == 0 ? g.name(g.start) + "'" : g.name(t.prodLhs[(size_t)p]);
+}
+
+static string lrProductionToString(const Grammar &g, const LRTable &t, int p) {
+    const vector<Sym> &rhs = t.prodRhs[(size_t)p];
+    return lrLhsName(g, t, p) + " -> " + (rhs.empty() ? EPS : g.rhsToString(rhs));
+}
+
+static string lrItemToString(const Grammar &g, const LRTable &t, int it) {
+    int p = (int)(upper_bound(t.itemBase.begin(), t.itemBase.end(), it) - t.itemBase.begin()) - 1;
+    size_t dot = (size_t)(it - t.itemBase[(size_t)p]);
+    const vector<Sym> &rhs = t.prodRhs[(size_t)p];
+    string s = lrLhsName(g, t, p) + " ->";
+    for (size_t k = 0; k <= rhs.size(); k++) {
+        if (k == dot) s += " .";
+        if (k < rhs.size()) s += " " + g.name(rhs[k]);
+    }
+    return s;
+}
+
+static string lrActionToString(int v) {
+    if (v == LRTable::ERROR) return ".";
+    if (v > 0) return "s" + to_string(v - 1);
+    if (v == LRTable::reduce(0)) return "acc";
+    return "r" + to_string(-v - 1);
+}
+
+static void printLRTable(const Grammar &g, const LRTable &t, bool showTable) {
+    const char *name = t.mode == LRMode::SLR ? "SLR(1)" : "LALR(1)";
+    cout << "\n--- Productions ---\n";
+    for (size_t p = 0; p < t.prodRhs.size(); p++) cout << "  " << p << ") " << lrProductionToString(g, t, (int)p) << "\n";
+
+    if (showTable) {
+        cout << "\n--- LR(0) item sets (kernels) ---\n";
+        for (size_t s = 0; s < t.states(); s++) {
+            cout << "I" << s << ":";
+            for (int k = t.kernelBegin[s]; k < t.kernelBegin[s + 1]; k++)
+                cout << (k == t.kernelBegin[s] ? " " : " | ") << lrItemToString(g, t, t.kernelItems[(size_t)k]);
+            cout << "\n";
+        }
+
+        vector<Sym> cols = g.terminals;
+        if (!g.isTerminal(SYM_END)) cols.push_back(SYM_END);
+        sort(cols.begin(), cols.end(), [&](Sym x, Sym y) { return g.nameLess(x, y); });
+        cout << "\n--- " << name << " ACTION / GOTO ---\n";
+        cout << setw(6) << "state";
+        for (Sym a : cols) cout << setw(6) << g.name(a);
+        cout << setw(6) << "dflt" << " |";
+        for (Sym A : g.nonterminals) cout << setw(6) << g.name(A);
+        cout << "\n";
+        // GOTO(s, A) exists for the nonterminals after a dot in the closure of s: those
+        // after a kernel dot, then the first symbols of their productions.
+        vector<char> hasGoto(g.symtab.size());
+        vector<Sym> pending;
+        for (size_t s = 0; s < t.states(); s++) {
+            fill(hasGoto.begin(), hasGoto.end(), 0);
+            auto want = [&](Sym X) {
+                if (!g.isNonTerminal(X) || hasGoto[(size_t)X]) return;
+                hasGoto[(size_t)X] = 1;
+                pending.push_back(X);
+            };
+            for (int k = t.kernelBegin[s]; k < t.kernelBegin[s + 1]; k++) {
+                int it = t.kernelItems[(size_t)k];
+                int p = (int)(upper_bound(t.itemBase.begin(), t.itemBase.end(), it) - t.itemBase.begin()) - 1;
+                size_t dot = (size_t)(it - t.itemBase[(size_t)p]);
+                if (dot < t.prodRhs[(size_t)p].size()) want(t.prodRhs[(size_t)p][dot]);
+            }
+            while (!pending.empty()) {
+                Sym B = pending.back();
+                pending.pop_back();
+                for (size_t p = 1; p < t.prodRhs.size(); p++)
+                    if (t.prodLhs[p] == B && !t.prodRhs[p].empty()) want(t.prodRhs[p][0]);
+            }
+
+            cout << setw(6) << s;
+            for (Sym a : cols) cout << setw(6) << lrActionToString(t.explicitAction((int)s, a));
+            cout << setw(6) << lrActionToString(t.defaultAction[s]) << " |";
+            for (Sym A : g.nonterminals) {
+                if (hasGoto[(size_t)A]) cout << setw(6) << t.go((int)s, A);
+                else cout << setw(6) << ".";
+            }
+            cout << "\n";
+        }
+    }
+
+    size_t entries = 0;
+    for (auto &e : t.actionSlots) entries += e.owner >= 0;
+    cout << "\nStates: " << t.states() << ", items in kernels: " << t.kernelItems.size()
+         << ", packed ACTION slots: " << t.actionSlots.size() << " (" << entries << " used)"
+         << ", GOTO slots: " << t.gotoSlots.size() << "\n";
+    if (t.conflicts.empty()) {
+        cout << "No conflicts. Grammar is " << name << ".\n";
+        return;
+    }
+    cout << "WARNING: " << t.conflicts.size() << " conflict(s); resolved in favour of shift, then the earlier production:\n";
+    for (size_t i = 0; i < t.conflicts.size() && i < 20; i++) {
+        const auto &c = t.conflicts[i];
+        cout << "  state " << c.state << " on " << g.name(c.terminal) << ": " << lrActionToString(c.kept)
+             << " over " << lrActionToString(c.dropped)
+             << (c.dropped > 0 || c.kept > 0 ? " (shift/reduce)" : " (reduce/reduce)") << "\n";
+    }
+}
+
+static bool lrParse(const Grammar &g, const LRTable &t, const string &inputStr, bool showSteps = true) {
+    vector<string> inp = tokenizeExpressionInput(inputStr);
+    vector<Sym> in;
+    for (auto &s : inp) in.push_back(g.symtab.find(s));
+    size_t ip = 0;
+
+    vector<int> st{0};
+    vector<Sym> syms;
+    auto stackStr = [&]() {
+        string s = "0";
+        for (size_t k = 0; k < syms.size(); k++) s += " " + g.name(syms[k]) + " " + to_string(st[k + 1]);
+        return s;
+    };
+
+    if (showSteps) {
+        cout << "\n--- LR Parsing Steps ---\n";
+        cout << left << setw(30) << "STACK" << setw(35) << "INPUT" << "ACTION\n";
+        cout << string(80, '-') << "\n";
+    }
+    while (true) {
+        Sym a = ip < in.size() ? in[ip] : SYM_END;
+        int act = t.action(st.back(), a);
+        if (showSteps) cout << left << setw(30) << stackStr() << setw(35) << inputToString(inp, ip);
+
+        if (act == LRTable::ERROR) {
+            if (showSteps) cout << "ERROR (no action for [" << st.back() << "," << (ip < inp.size() ? inp[ip] : END_MARK) << "])\n";
+            return false;
+        }
+        if (act > 0) {
+            st.push_back(act - 1);
+            syms.push_back(a);
+            ip++;
+            if (showSteps) cout << "shift " << act - 1 << "\n";
+            continue;
+        }
+        int p = -act - 1;
+        if (p == 0) {
+            if (showSteps) cout << "ACCEPT\n";
+            return true;
+        }
+        size_t n = t.prodRhs[(size_t)p].size();
+        st.resize(st.size() - n);
+        syms.resize(syms.size() - n);
+        Sym A = t.prodLhs[(size_t)p];
+        st.push_back(t.go(st.back(), A));
+        syms.push_back(A);
+        if (showSteps) cout << "reduce " << lrProductionToString(g, t, p) << "\n";
+    }
+}
+
+// ----------------------------- Parser Generator -----------------------------
+static string cStringLiteral(const string &s) {
+    string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (c < 0x20 || c >= 0x7f) {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\%03o", c);
+            out += buf;
+        } else {
+            out += (char)c;
+        }
+    }
+    return out + "\"";
+}
+
+// [A-Za-z_][A-Za-z0-9_]*, not a C++ keyword and not reserved for the implementation
+// (containing "__", or "_" then an uppercase letter), so it cannot meet a library macro.
+// The grammar's isIdentChar also allows '.
+static bool isCppIdentifier(const string &s) {
+    static const unordered_set<string> keywords = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case",
+        "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval",
+        "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype",
+        "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+        "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+        "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public",
+        "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+        "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+        "wchar_t", "while", "xor", "xor_eq"};
+    if (s.empty() || isdigit((unsigned char)s[0])) return false;
+    for (unsigned char c : s)
+        if (!isalnum(c) && c != '_') return false;
+    if (s.find("__") != string::npos || (s[0] == '_' && s.size() > 1 && isupper((unsigned char)s[1]))) return false;
+    return !keywords.count(s);
+}
+
+static void emitIntArray(ostream &out, const string &name, const vector<int> &v) {
+    out << "static constexpr int " << name << "[" << v.size() << "] = {";
+    for (size_t i = 0; i < v.size(); i++) out << (i % 16 ? " " : "\n    ") << v[i] << ",";
+    out << "\n};\n\n";
+}
+
+// Writes a self-contained C++17 header: the packed LL(1) table as static constexpr
+// arrays plus an inlined table-driven parse loop. Terminals are numbered by table
+// column, nonterminals by table row; no grammar analysis happens at runtime.
+static bool emitParserHeader(const Grammar &g,
+                             const ParseTable &table,
+                             const vector<Sym> &cols,
+                             const string &ns,
+                             ostream &out) {
+    if (table.conflict || g.start < 0 || !isCppIdentifier(ns)) return false;
+
+    const int nT = (int)cols.size();
+    auto encode = [&](Sym X) {
+        return g.isNonTerminal(X) ? nT + table.rowOf[(size_t)X] : table.colOf[(size_t)X];
+    };
+
+    vector<int> lhs, rhsBegin, rhs;
+    for (size_t p = 0; p < table.prodRhs.size(); p++) {
+        lhs.push_back(table.rowOf[(size_t)table.prodLhs[p]]);
+        rhsBegin.push_back((int)rhs.size());
+        for (Sym X : table.prodRhs[p])
+            if (X != SYM_EPS) rhs.push_back(encode(X));
+    }
+    rhsBegin.push_back((int)rhs.size());
+    rhs.push_back(-1); // sentinel, keeps the array non-empty
+
+    vector<int> owner, prod;
+    for (auto &s : table.slots) {
+        owner.push_back(s.owner);
+        prod.push_back(s.prod);
+    }
+
+    out << "// Generated by Mini Compiler. Do not edit.\n//\n";
+    for (Sym A : g.nonterminals) {
+        out << "//   " << g.name(A) << " -> ";
+        const auto &alts = g.prod[(size_t)A];
+        for (size_t i = 0; i < alts.size(); i++) {
+            if (i) out << " | ";
+            out << g.rhsToString(alts[i]);
+        }
+        out << "\n";
+    }
+    out << "\n#pragma once\n\n#include <cstddef>\n#include <string_view>\n#include <vector>\n\n";
+    out << "namespace " << ns << " {\n\n";
+    out << "// Symbols: terminal t is t, nonterminal A is NUM_TERMINALS + A.\n";
+    out << "static constexpr int NUM_TERMINALS = " << nT << ";\n";
+    out << "static constexpr int NUM_NONTERMINALS = " << g.nonterminals.size() << ";\n";
+    out << "static constexpr int NUM_PRODUCTIONS = " << lhs.size() << ";\n";
+    out << "static constexpr int END_TERMINAL = " << table.colOf[(size_t)SYM_END] << "; // "
+        << END_MARK << "\n";
+    out << "static constexpr int START = " << table.rowOf[(size_t)g.start] << "; // " << g.name(g.start)
+        << "\n\n";
+
+    out << "static constexpr const char *TERMINAL_NAMES[NUM_TERMINALS] = {";
+    for (int c = 0; c < nT; c++) out << (c ? ", " : "") << cStringLiteral(g.name(cols[(size_t)c]));
+    out << "};\n\n";
+    out << "static constexpr const char *NONTERMINAL_NAMES[NUM_NONTERMINALS] = {";
+    for (size_t r = 0; r < g.nonterminals.size(); r++)
+        out << (r ? ", " : "") << cStringLiteral(g.name(g.nonterminals[r]));
+    out << "};\n\n";
+
+    out << "// Production p is PROD_LHS[p] -> RHS[RHS_BEGIN[p] .. RHS_BEGIN[p + 1]) (eps is empty).\n";
+    emitIntArray(out, "PROD_LHS", lhs);
+    emitIntArray(out, "RHS_BEGIN", rhsBegin);
+    emitIntArray(out, "RHS", rhs);
+    out << "// M[A, t] lives in slot BASE[A] + t when SLOT_OWNER says it belongs to A.\n";
+    emitIntArray(out, "BASE", table.base);
+    emitIntArray(out, "SLOT_OWNER", owner);
+    emitIntArray(out, "SLOT_PROD", prod);
+
+    out << R"GEN(inline int terminalId(std::string_view name) {
+    for (int t = 0; t < NUM_TERMINALS; t++)
+        if (name == TERMINAL_NAMES[t]) return t;
+    return -1;
+}
+
+// Production to expand nonterminal A on lookahead t, or -1.
+inline int lookup(int A, int t) {
+    if (t < 0 || t >= NUM_TERMINALS) return -1;
+    int s = BASE[A] + t;
+    return SLOT_OWNER[s] == A ? SLOT_PROD[s] : -1;
+}
+
+// Parses n terminal ids (END_TERMINAL is implied after the last one). onRule(p) is
+// called for each expansion, in leftmost-derivation order.
+template <class OnRule>
+bool parse(const int *tokens, std::size_t n, OnRule &&onRule) {
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(END_TERMINAL);
+    stack.push_back(NUM_TERMINALS + START);
+    std::size_t ip = 0;
+    while (!stack.empty()) {
+        int X = stack.back();
+        int a = ip < n ? tokens[ip] : END_TERMINAL;
+        if (X < NUM_TERMINALS) {
+            if (X != a) return false;
+            if (X == END_TERMINAL) return ip >= n;
+            stack.pop_back();
+            ip++;
+            continue;
+        }
+        int p = lookup(X - NUM_TERMINALS, a);
+        if (p < 0) return false;
+        onRule(p);
+        stack.pop_back();
+        for (int i = RHS_BEGIN[p + 1]; i-- > RHS_BEGIN[p];) stack.push_back(RHS[i]);
+    }
+    return false;
+}
+
+inline bool parse(const int *tokens, std::size_t n) {
+    return parse(tokens, n, [](int) {});
+}
+
+)GEN";
+    out << "} // namespace " << ns << "\n";
+    return true;
+}
+
+// ----------------------------- Byte Scanning Kernels -----------------------------
+// ASCII character classes for the lexing paths. Unlike isspace/isalnum these do not
+// depend on the C locale (they match the default "C" locale exactly).
+enum : uint8_t { CC_SPACE = 1, CC_DIGIT = 2, CC_ALPHA = 4, CC_IDENT = 8 };
+
+struct CharClassTable {
+    uint8_t v[256];
+};
+
+static constexpr CharClassTable makeCharClassTable() {
+    CharClassTable t{};
+    for (int c = 0; c < 256; c++) {
+        uint8_t k = 0;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) k |= CC_SPACE;
+        if (c >= '0' && c <= '9') k |= CC_DIGIT | CC_IDENT;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) k |= CC_ALPHA | CC_IDENT;
+        if (c == '_') k |= CC_IDENT;
+        t.v[c] = k;
+    }
+    return t;
+}
+
+static constexpr CharClassTable CHAR_CLASS = makeCharClassTable();
+
+static inline bool ccIs(char c, uint8_t k) { return (CHAR_CLASS.v[(unsigned char)c] & k) != 0; }
+
+// Scalar kernels (also used for the tails of the vector ones).
+static const char *findAny4Scalar(const char *p, const char *end, char a, char b, char c, char d) {
+    for (; p < end; p++) {
+        char x = *p;
+        if (x == a || x == b || x == c || x == d) return p;
+    }
+    return end;
+}
+
+static const char *skipIdentScalar(const char *p, const char *end) {
+    while (p < end && ccIs(*p, CC_IDENT)) p++;
+    return p;
+}
+
+static const char *skipSpaceScalar(const char *p, const char *end) {
+    while (p < end && ccIs(*p, CC_SPACE)) p++;
+    return p;
+}
+
+#ifdef MC_X86_SIMD
+// Unsigned "x - lo <= span" per byte, the SSE2 way (no unsigned compares).
+__attribute__((target("sse2")))
+static inline __m128i inRange16(__m128i x, char lo, char span) {
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    __m128i k = _mm_set1_epi8(span);
+    return _mm_cmpeq_epi8(_mm_max_epu8(t, k), k);
+}
+
+__attribute__((target("sse2")))
+static const char *findAny4SSE2(const char *p, const char *end, char a, char b, char c, char d) {
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c), vd = _mm_set1_epi8(d);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, va), _mm_cmpeq_epi8(x, vb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(x, vc), _mm_cmpeq_epi8(x, vd)));
+        unsigned bits = (unsigned)_mm_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return findAny4Scalar(p, end, a, b, c, d);
+}
+
+__attribute__((target("sse2")))
+static const char *skipIdentSSE2(const char *p, const char *end) {
+    const __m128i lower = _mm_set1_epi8(0x20), under = _mm_set1_epi8('_');
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(inRange16(_mm_or_si128(x, lower), 'a', 'z' - 'a'),
+                                 _mm_or_si128(inRange16(x, '0', 9), _mm_cmpeq_epi8(x, under)));
+        unsigned bits = (unsigned)_mm_movemask_epi8(m) ^ 0xFFFFu;
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return skipIdentScalar(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char *skipSpaceSSE2(const char *p, const char *end) {
+    const __m128i sp = _mm_set1_epi8(' ');
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(x, sp), inRange16(x, '\t', '\r' - '\t'));
+        unsigned bits = (unsigned)_mm_movemask_epi8(m) ^ 0xFFFFu;
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return skipSpaceScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i inRange32(__m256i x, char lo, char span) {
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    __m256i k = _mm256_set1_epi8(span);
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(t, k), k);
+}
+
+__attribute__((target("avx2")))
+static const char *findAny4AVX2(const char *p, const char *end, char a, char b, char c, char d) {
+    const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c), vd = _mm256_set1_epi8(d);
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, va), _mm256_cmpeq_epi8(x, vb)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(x, vc), _mm256_cmpeq_epi8(x, vd)));
+        unsigned bits = (unsigned)_mm256_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return findAny4SSE2(p, end, a, b, c, d);
+}
+
+__attribute__((target("avx2")))
+static const char *skipIdentAVX2(const char *p, const char *end) {
+    const __m256i lower = _mm256_set1_epi8(0x20), under = _mm256_set1_epi8('_');
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i m = _mm256_or_si256(inRange32(_mm256_or_si256(x, lower), 'a', 'z' - 'a'),
+                                    _mm256_or_si256(inRange32(x, '0', 9), _mm256_cmpeq_epi8(x, under)));
+        unsigned bits = ~(unsigned)_mm256_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return skipIdentSSE2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char *skipSpaceAVX2(const char *p, const char *end) {
+    const __m256i sp = _mm256_set1_epi8(' ');
+    for (; end - p >= 32; p += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)p);
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(x, sp), inRange32(x, '\t', '\r' - '\t'));
+        unsigned bits = ~(unsigned)_mm256_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz(bits);
+    }
+    return skipSpaceSSE2(p, end);
+}
+#endif
+
+struct ScanKernels {
+    const char *name;
+    // First byte equal to any of a/b/c/d (repeat a needle to search for fewer), or end.
+    const char *(*findAny4)(const char *, const char *, char, char, char, char);
+    // First byte that is not [A-Za-z0-9_] / not whitespace, or end.
+    const char *(*skipIdent)(const char *, const char *);
+    const char *(*skipSpace)(const char *, const char *);
+};
+
+// Picks the widest kernel set the CPU supports. MINI_COMPILER_SIMD=scalar|sse2 caps
+// the choice (handy for comparing the paths).
+static ScanKernels selectScanKernels() {
+    ScanKernels k = {"scalar", findAny4Scalar, skipIdentScalar, skipSpaceScalar};
+#ifdef MC_X86_SIMD
+    const char *env = getenv("MINI_COMPILER_SIMD");
+    string cap = env ? env : "";
+    if (cap == "scalar") return k;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) k = {"sse2", findAny4SSE2, skipIdentSSE2, skipSpaceSSE2};
+    if (cap == "sse2") return k;
+    if (__builtin_cpu_supports("avx2")) k = {"avx2", findAny4AVX2, skipIdentAVX2, skipSpaceAVX2};
+#endif
+    return k;
+}
+
+static const ScanKernels &scanKernels() {
+    static const ScanKernels k = selectScanKernels();
+    return k;
+}
+
+// ----------------------------- Lab 01: Comment Removal -----------------------------
+// Byte-level state machine with no lookahead: a '/' (or a '*' inside a block comment)
+// is remembered in the state instead, so input may be fed in chunks of any size and
+// a comment opener or closer split across two chunks is still recognised.
+struct CommentStripper {
+    bool inString = false, inChar = false;
+    bool inSL = false, inML = false;
+    bool esc = false;
+    bool slash = false; // '/' seen outside comments/literals, decided by the next byte
+    bool star = false;  // '*' seen inside a multi-line comment
+
+    // sink(const char *p, size_t n) receives the kept bytes, in order.
+    template <class Sink>
+    void feed(const char *p, size_t n, Sink &&sink) {
+        const char *end = p + n;
+        const char *run = p; // start of the bytes currently being copied through
+        const ScanKernels &K = scanKernels();
+
+        // Each state jumps straight to the next byte that can change it; everything
+        // skipped over is either kept (code, literals) or dropped (comments) as a block.
+        for (const char *q = p; q < end; q++) {
+            if (slash) {
+                slash = false;
+                if (*q == '/') { inSL = true; run = q + 1; continue; }
+                if (*q == '*') { inML = true; run = q + 1; continue; }
+                sink("/", 1); // plain division operator; *q is handled normally below
+            }
+
+            if (inSL) {
+                const char *nl = (const char *)memchr(q, '\n', (size_t)(end - q));
+                if (!nl) { run = end; break; }
+                inSL = false;
+                q = nl;
+                run = q; // newline is kept
+                continue;
+            }
+
+            if (inML) {
+                if (star && *q == '/') {
+                    inML = star = false;
+                    run = q + 1;
+                    continue;
+                }
+                const char *st = (const char *)memchr(q, '*', (size_t)(end - q));
+                star = (st != nullptr);
+                if (!st) { run = end; break; }
+                q = st;
+                run = q + 1;
+                continue;
+            }
+
+            if (inString || inChar) {
+                if (esc) { esc = false; continue; } // escaped byte
+                char quote = inString ? '"' : '\'';
+                q = K.findAny4(q, end, quote, '\\', quote, quote);
+                if (q == end) break;
+                if (*q == '\\') esc = true;
+                else inString = inChar = false;
+                continue;
+            }
+
+            // not inside string/char/comment
+            q = K.findAny4(q, end, '/', '"', '\'', '/');
+            if (q == end) break;
+            char c = *q;
+            if (c == '"') { inString = true; esc = false; continue; }
+            if (c == '\'') { inChar = true; esc = false; continue; }
+            if (q > run) sink(run, (size_t)(q - run));
+            slash = true;
+            run = q + 1;
+        }
+        if (end > run) sink(run, (size_t)(end - run));
+    }
+
+    // Flush a trailing '/' that never got its second byte.
+    template <class Sink>
+    void finish(Sink &&sink) {
+        if (slash) sink("/", 1);
+        slash = false;
+    }
+};
+
+static string removeCComments(const string &code) {
+    PhaseScope stats(Phase::RemoveComments);
+    stats.add(STAT_BYTES, code.size());
+    string out;
+    out.reserve(code.size());
+    auto sink = [&](const char *p, size_t n) { out.append(p, n); };
+    CommentStripper cs;
+    cs.feed(code.data(), code.size(), sink);
+    cs.finish(sink);
+    return out;
+}
+
+// Streaming variant: reads `in` in fixed-size chunks and writes kept bytes straight to
+// `out`, so memory use is one chunk regardless of input size. Returns bytes consumed.
+static size_t removeCCommentsStream(istream &in, ostream &out, size_t chunkSize = 1 << 16) {
+    PhaseScope stats(Phase::RemoveComments);
+    vector<char> buf(chunkSize);
+    auto sink = [&](const char *p, size_t n) { out.write(p, (streamsize)n); };
+    CommentStripper cs;
+    size_t total = 0;
+    while (in) {
+        in.read(buf.data(), (streamsize)buf.size());
+        size_t got = (size_t)in.gcount();
+        if (got == 0) break;
+        cs.feed(buf.data(), got, sink);
+        total += got;
+    }
+    cs.finish(sink);
+    stats.add(STAT_BYTES, total);
+    return total;
+}
+
+// ----------------------------- Lab 02: Tokenizer (simple C-like) -----------------------------
+enum class TokType {
+    KEYWORD, IDENTIFIER, NUMBER, STRING_LIT, CHAR_LIT,
+    OPERATOR, SEPARATOR, PREPROCESSOR, UNKNOWN
+};
 
 static string tokTypeName(TokType t) {
     switch (t) {
@@ -896,168 +3959,957 @@ static string tokTypeName(TokType t) {
     }
 }
 
+// Tokens do not own their text: `lexeme` views the buffer handed to tokenizeC, which
+// must outlive the token vector.
 struct Token {
     TokType type;
-    string lexeme;
+    string_view lexeme;
     int line;
 };
 
-static bool isKeyword(const string &s) {
-    static const unordered_set<string> kw = {
-        "auto","break","case","char","const","continue","default","do","double","else","enum",
-        "extern","float","for","goto","if","inline","int","long","register","restrict","return",
-        "short","signed","sizeof","static","struct","switch","typedef","union","unsigned","void",
-        "volatile","while","_Bool","_Complex","_Imaginary",
-        // common C++ too
-        "class","namespace","public","private","protected","template","typename","using","new","delete",
-        "try","catch","throw","this","operator","friend","virtual","override","nullptr","bool"
+// Keyword lookup is a perfect hash generated at compile time: a seed is searched for
+// that maps every keyword to its own slot, so a lookup is a length check, one hash
+// of (length, first two bytes, last byte) and a single compare.
+static constexpr string_view C_KEYWORDS[] = {
+    "auto","break","case","char","const","continue","default","do","double","else","enum",
+    "extern","float","for","goto","if","inline","int","long","register","restrict","return",
+    "short","signed","sizeof","static","struct","switch","typedef","union","unsigned","void",
+    "volatile","while","_Bool","_Complex","_Imaginary",
+    // common C++ too
+    "class","namespace","public","private","protected","template","typename","using","new","delete",
+    "try","catch","throw","this","operator","friend","virtual","override","nullptr","bool"
+};
+static constexpr size_t NUM_KEYWORDS = sizeof(C_KEYWORDS) / sizeof(C_KEYWORDS[0]);
+static constexpr int KW_HASH_BITS = 9;
+static constexpr size_t KW_MIN_LEN = 2, KW_MAX_LEN = 10;
+
+static constexpr uint32_t keywordHash(string_view s, uint32_t seed) {
+    uint32_t h = seed ^ ((uint32_t)s.size() * 0x9E3779B1u);
+    h = (h ^ (unsigned char)s[0]) * 0x85EBCA6Bu;
+    h = (h ^ (unsigned char)s[1]) * 0xC2B2AE35u;
+    h = (h ^ (unsigned char)s[s.size() - 1]) * 0x27D4EB2Fu;
+    return h >> (32 - KW_HASH_BITS);
+}
+
+struct KeywordHashTable {
+    uint32_t seed;                     // 0 = no perfect seed found
+    uint8_t slot[1u << KW_HASH_BITS];  // keyword id + 1, 0 = empty
+};
+
+static constexpr KeywordHashTable buildKeywordHashTable() {
+    for (uint32_t seed = 1; seed < 20000; seed++) {
+        KeywordHashTable t{};
+        t.seed = seed;
+        bool ok = true;
+        for (size_t i = 0; i < NUM_KEYWORDS && ok; i++) {
+            size_t len = C_KEYWORDS[i].size();
+            if (len < KW_MIN_LEN || len > KW_MAX_LEN) return KeywordHashTable{};
+            uint8_t &slot = t.slot[keywordHash(C_KEYWORDS[i], seed)];
+            if (slot) ok = false;
+            else slot = (uint8_t)(i + 1);
+        }
+        if (ok) return t;
+    }
+    return KeywordHashTable{};
+}
+
+static constexpr KeywordHashTable KEYWORD_HASH = buildKeywordHashTable();
+static_assert(KEYWORD_HASH.seed != 0, "no collision-free keyword hash seed found");
+
+// Index into C_KEYWORDS, or -1 if s is not a keyword.
+static int keywordId(string_view s) {
+    if (s.size() < KW_MIN_LEN || s.size() > KW_MAX_LEN) return -1;
+    uint8_t slot = KEYWORD_HASH.slot[keywordHash(s, KEYWORD_HASH.seed)];
+    if (!slot) return -1;
+    string_view k = C_KEYWORDS[slot - 1];
+    return (k.size() == s.size() && memcmp(k.data(), s.data(), s.size()) == 0) ? slot - 1 : -1;
+}
+
+static bool isKeyword(string_view s) {
+    return keywordId(s) >= 0;
+}
+
+// Lexer DFA, built at compile time. next[state][byte] is the only lookup per byte;
+// accept[state] is TokType + 1 (0 = not an accepting state). The driver keeps the
+// last accepting position, so operators are matched maximal-munch with backtrack
+// (e.g. ".." lexes as two '.' separators).
+enum LexState : uint8_t {
+    LS_DEAD, LS_START, LS_IDENT, LS_PP,
+    LS_NUM, LS_NUM_DOT, LS_NUM_E, LS_NUM_DOT_E, // E = just consumed an exponent marker
+    LS_STR, LS_STR_ESC, LS_STR_END, LS_CHR, LS_CHR_ESC, LS_CHR_END,
+    LS_UNKNOWN, LS_FIRST_OP // operator/separator trie states follow
+};
+
+struct LexDFA {
+    static constexpr int MAX_STATES = 96;
+    uint8_t next[MAX_STATES][256];
+    uint8_t accept[MAX_STATES];
+    int states;
+};
+
+static constexpr void lexAddPunct(LexDFA &d, const char *lex, TokType t) {
+    uint8_t st = LS_START;
+    for (; *lex; lex++) {
+        uint8_t &nx = d.next[st][(unsigned char)*lex];
+        if (nx == LS_DEAD || nx == LS_UNKNOWN) nx = (uint8_t)d.states++;
+        st = nx;
+    }
+    d.accept[st] = (uint8_t)((int)t + 1);
+}
+
+static constexpr LexDFA buildLexDFA() {
+    LexDFA d{};
+    d.states = LS_FIRST_OP;
+    auto acc = [](TokType t) { return (uint8_t)((int)t + 1); };
+
+    for (int c = 0; c < 256; c++) {
+        uint8_t k = CHAR_CLASS.v[c];
+        bool digit = (k & CC_DIGIT), ident = (k & CC_IDENT);
+
+        d.next[LS_START][c] = (k & CC_SPACE) ? LS_DEAD : LS_UNKNOWN; // spaces are skipped by the driver
+        if (ident && !digit) d.next[LS_START][c] = LS_IDENT;
+        if (digit) d.next[LS_START][c] = LS_NUM;
+        if (ident) d.next[LS_IDENT][c] = LS_IDENT;
+        d.next[LS_PP][c] = (c == '\n') ? LS_DEAD : LS_PP;
+
+        if (digit) {
+            d.next[LS_NUM][c] = d.next[LS_NUM_E][c] = LS_NUM;
+            d.next[LS_NUM_DOT][c] = d.next[LS_NUM_DOT_E][c] = LS_NUM_DOT;
+        }
+        if (c == 'e' || c == 'E') {
+            d.next[LS_NUM][c] = d.next[LS_NUM_E][c] = LS_NUM_E;
+            d.next[LS_NUM_DOT][c] = d.next[LS_NUM_DOT_E][c] = LS_NUM_DOT_E;
+        }
+        if (c == '+' || c == '-') {
+            d.next[LS_NUM_E][c] = LS_NUM;
+            d.next[LS_NUM_DOT_E][c] = LS_NUM_DOT;
+        }
+        if (c == '.') d.next[LS_NUM][c] = d.next[LS_NUM_E][c] = LS_NUM_DOT;
+
+        d.next[LS_STR][c] = (c == '"') ? LS_STR_END : (c == '\\') ? LS_STR_ESC : LS_STR;
+        d.next[LS_STR_ESC][c] = LS_STR;
+        d.next[LS_CHR][c] = (c == '\'') ? LS_CHR_END : (c == '\\') ? LS_CHR_ESC : LS_CHR;
+        d.next[LS_CHR_ESC][c] = LS_CHR;
+    }
+    d.next[LS_START][(unsigned char)'#'] = LS_PP;
+    d.next[LS_START][(unsigned char)'"'] = LS_STR;
+    d.next[LS_START][(unsigned char)'\''] = LS_CHR;
+
+    d.accept[LS_IDENT] = acc(TokType::IDENTIFIER);
+    d.accept[LS_PP] = acc(TokType::PREPROCESSOR);
+    d.accept[LS_NUM] = d.accept[LS_NUM_DOT] = acc(TokType::NUMBER);
+    d.accept[LS_NUM_E] = d.accept[LS_NUM_DOT_E] = acc(TokType::NUMBER);
+    // Unterminated literals run to end of input, so every literal state accepts.
+    d.accept[LS_STR] = d.accept[LS_STR_ESC] = d.accept[LS_STR_END] = acc(TokType::STRING_LIT);
+    d.accept[LS_CHR] = d.accept[LS_CHR_ESC] = d.accept[LS_CHR_END] = acc(TokType::CHAR_LIT);
+    d.accept[LS_UNKNOWN] = acc(TokType::UNKNOWN);
+
+    // "##" is omitted: '#' always opens a preprocessor line.
+    const char *ops[] = {"<<=", ">>=", "...",
+                         "++","--","==","!=","<=",">=","&&","||","+=","-=","*=","/=","%=",
+                         "<<",">>","->","::","&=","|=","^=",
+                         "+","-","*","/","%","<",">","=","!","&","|","^","~"};
+    const char *seps[] = {";", ",", "(", ")", "{", "}", "[", "]", ":", "?", "."};
+    for (const char *s : seps) lexAddPunct(d, s, TokType::SEPARATOR);
+    for (const char *s : ops) lexAddPunct(d, s, TokType::OPERATOR);
+    return d;
+}
+
+static constexpr LexDFA LEX_DFA = buildLexDFA();
+static_assert(LEX_DFA.states <= LexDFA::MAX_STATES, "lexer DFA state budget exceeded");
+
+// Lexes the tokens of `code` that start in [from, limit), appending them to `tokens`;
+// `line` is the line number at `from`. A token may run past `limit` (a literal spanning
+// the boundary). Returns the end of the last token, or `from` if there was none.
+static size_t lexRange(string_view code, size_t from, size_t limit, int line, vector<Token> &tokens) {
+    const ScanKernels &K = scanKernels();
+    const unsigned char *base = (const unsigned char *)code.data();
+    const size_t n = code.size();
+    size_t lastEnd = from;
+
+    for (size_t i = from; i < n;) {
+        unsigned char c = base[i];
+
+        if (CHAR_CLASS.v[c] & CC_SPACE) {
+            const char *ws = K.skipSpace(code.data() + i, code.data() + n);
+            line += (int)count(code.data() + i, ws, '\n');
+            i = (size_t)(ws - code.data());
+            continue;
+        }
+        if (i >= limit) break;
+
+        uint8_t st = LEX_DFA.next[LS_START][c];
+        size_t j = i + 1;
+        size_t tokEnd = j;
+        uint8_t tokAcc = LEX_DFA.accept[st];
+
+        // Self-looping states with long runs go through the scanning kernels.
+        if (st == LS_IDENT) {
+            tokEnd = j = (size_t)(K.skipIdent(code.data() + j, code.data() + n) - code.data());
+        } else if (st == LS_PP) {
+            const void *nl = memchr(base + j, '\n', n - j);
+            tokEnd = j = nl ? (size_t)((const unsigned char *)nl - base) : n;
+        } else {
+            while (j < n) {
+                uint8_t nx = LEX_DFA.next[st][base[j]];
+                if (nx == LS_DEAD) break;
+                st = nx;
+                j++;
+                if (LEX_DFA.accept[st]) {
+                    tokEnd = j;
+                    tokAcc = LEX_DFA.accept[st];
+                }
+            }
+            // An exponent marker is only part of a number if something follows it.
+            if (j == n && (st == LS_NUM_E || st == LS_NUM_DOT_E)) tokEnd = j - 1;
+        }
+
+        TokType t = (TokType)(tokAcc - 1);
+        string_view lex = code.substr(i, tokEnd - i);
+        if (t == TokType::IDENTIFIER && isKeyword(lex)) t = TokType::KEYWORD;
+        if (t == TokType::STRING_LIT || t == TokType::CHAR_LIT) line += (int)count(lex.begin(), lex.end(), '\n');
+        tokens.push_back({t, lex, line});
+        i = lastEnd = tokEnd;
+    }
+    return lastEnd;
+}
+
+static vector<Token> tokenizeC(string_view code) {
+    PhaseScope stats(Phase::TokenizeC);
+    vector<Token> tokens;
+    lexRange(code, 0, code.size(), 1, tokens);
+    stats.add(STAT_BYTES, code.size());
+    stats.add(STAT_TOKENS, tokens.size());
+    return tokens;
+}
+
+// The token views would dangle if the source were a temporary.
+static vector<Token> tokenizeC(string &&code) = delete;
+
+// ----------------------------- Work-Stealing Thread Pool -----------------------------
+// Each worker owns a deque. Tasks are dealt round-robin; an owner takes from the front
+// of its own deque (so submission order is roughly execution order) and an idle worker
+// steals from the back of someone else's.
+class WorkStealingPool {
+public:
+    // Past this, more workers only add start-up and join cost.
+    static constexpr unsigned MAX_THREADS = 256;
+
+    explicit WorkStealingPool(unsigned threads) {
+        threads = min(max(threads, 1u), MAX_THREADS);
+        for (unsigned i = 0; i < threads; i++) queues.emplace_back(new Queue);
+        for (unsigned i = 0; i < threads; i++) workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> lk(sleepM);
+            stop = true;
+        }
+        workCv.notify_all();
+        for (auto &t : workers) t.join();
+    }
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    void submit(function<void()> task) {
+        pending++;
+        Queue &q = *queues[nextQueue++ % queues.size()];
+        {
+            lock_guard<mutex> lk(q.m);
+            q.tasks.push_back(move(task));
+        }
+        {
+            lock_guard<mutex> lk(sleepM);
+            queued++;
+        }
+        workCv.notify_one();
+    }
+
+    // Blocks until every submitted task has finished.
+    void wait() {
+        unique_lock<mutex> lk(doneM);
+        doneCv.wait(lk, [&] { return pending.load() == 0; });
+    }
+
+private:
+    struct Queue {
+        mutex m;
+        deque<function<void()>> tasks;
     };
-    return kw.count(s) > 0;
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+    size_t nextQueue = 0;
+    atomic<long> pending{0}, queued{0};
+    mutex sleepM, doneM;
+    condition_variable workCv, doneCv;
+    bool stop = false;
+
+    bool take(unsigned me, function<void()> &task) {
+        for (size_t k = 0; k < queues.size(); k++) {
+            Queue &q = *queues[(me + k) % queues.size()];
+            lock_guard<mutex> lk(q.m);
+            if (q.tasks.empty()) continue;
+            if (k == 0) {
+                task = move(q.tasks.front());
+                q.tasks.pop_front();
+            } else {
+                task = move(q.tasks.back());
+                q.tasks.pop_back();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned me) {
+        while (true) {
+            function<void()> task;
+            if (take(me, task)) {
+                task();
+                if (--pending == 0) {
+                    lock_guard<mutex> lk(doneM);
+                    doneCv.notify_all();
+                }
+                continue;
+            }
+            unique_lock<mutex> lk(sleepM);
+            workCv.wait(lk, [&] { return stop || queued.load() > 0; });
+            if (stop && queued.load() <= 0) return;
+        }
+    }
+};
+
+static unsigned defaultThreadCount() {
+    unsigned n = thread::hardware_concurrency();
+    return n ? n : 1;
 }
 
-static vector<Token> tokenizeC(const string &code) {
+// ----------------------------- Parallel Lexing of One Large File -----------------------------
+// The file is cut into chunks at line starts and every chunk is lexed concurrently on
+// the guess that it does not begin inside a literal. A serial pass then walks the
+// chunks in order carrying the true resume point (end of the last real token): a chunk
+// whose start is at or past that point was guessed right; otherwise it is re-lexed
+// from the resume point. Line numbers are chunk-relative during the parallel phase and
+// are shifted by a prefix sum of per-chunk newline counts when merging, so the result
+// is identical to tokenizeC.
+static vector<Token> tokenizeCParallel(string_view code, unsigned threads, size_t minChunk = 1 << 20) {
+    if (threads == 0) threads = defaultThreadCount();
+    size_t want = min<size_t>((size_t)threads * 4, code.size() / max<size_t>(minChunk, 1));
+    if (threads < 2 || want < 2) return tokenizeC(code);
+    PhaseScope stats(Phase::TokenizeC);
+
+    // chunk i covers [cut[i], cut[i+1])
+    vector<size_t> cut = {0};
+    for (size_t k = 1; k < want; k++) {
+        size_t target = max(code.size() * k / want, cut.back());
+        size_t nl = code.find('\n', target);
+        if (nl == string_view::npos) break;
+        if (nl + 1 > cut.back() && nl + 1 < code.size()) cut.push_back(nl + 1);
+    }
+    cut.push_back(code.size());
+    size_t chunks = cut.size() - 1;
+
+    struct Chunk {
+        vector<Token> tokens; // lines relative to the chunk start (0-based)
+        size_t end = 0;       // end of the last token
+        size_t newlines = 0;  // '\n' bytes inside [cut[i], cut[i+1])
+    };
+    vector<Chunk> parts(chunks);
+    {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < chunks; i++) {
+            pool.submit([&, i] {
+                Chunk &ch = parts[i];
+                ch.newlines = (size_t)count(code.begin() + (long long)cut[i], code.begin() + (long long)cut[i + 1], '\n');
+                ch.end = lexRange(code, cut[i], cut[i + 1], 0, ch.tokens);
+            });
+        }
+        pool.wait();
+    }
+
+    // Validate in order; re-lex chunks whose guessed start state was wrong.
+    size_t resume = 0, lineBase = 1;
+    for (size_t i = 0; i < chunks; i++) {
+        Chunk &ch = parts[i];
+        if (resume >= cut[i + 1]) {
+            ch.tokens.clear(); // swallowed by a token from an earlier chunk
+        } else if (resume <= cut[i]) {
+            for (auto &t : ch.tokens) t.line += (int)lineBase;
+            if (!ch.tokens.empty()) resume = ch.end;
+        } else {
+            int line = (int)(lineBase + (size_t)count(code.begin() + (long long)cut[i], code.begin() + (long long)resume, '\n'));
+            ch.tokens.clear();
+            size_t e = lexRange(code, resume, cut[i + 1], line, ch.tokens);
+            if (!ch.tokens.empty()) resume = e;
+        }
+        lineBase += ch.newlines;
+    }
+
+    size_t total = 0;
+    for (auto &ch : parts) total += ch.tokens.size();
     vector<Token> tokens;
-    int line = 1;
+    tokens.reserve(total);
+    for (auto &ch : parts) tokens.insert(tokens.end(), ch.tokens.begin(), ch.tokens.end());
+    stats.add(STAT_BYTES, code.size());
+    stats.add(STAT_TOKENS, tokens.size());
+    return tokens;
+}
 
-    auto push = [&](TokType t, const string &lex) {
-        tokens.push_back({t, lex, line});
+static vector<Token> tokenizeCParallel(string &&code, unsigned threads, size_t minChunk) = delete;
+
+// ----------------------------- Batch Lexing (Lab 01 + Lab 02 over many files) -----------------------------
+struct LexFileResult {
+    bool ok = false;
+    size_t bytes = 0;      // input size
+    size_t keptBytes = 0;  // size after comment removal
+    size_t tokens = 0;
+};
+
+static bool readWholeFile(const string &path, string &out) {
+    ifstream fin(path, ios::binary);
+    if (!fin) return false;
+    fin.seekg(0, ios::end);
+    streamoff len = fin.tellg();
+    fin.seekg(0, ios::beg);
+    out.resize(len > 0 ? (size_t)len : 0);
+    if (len > 0) fin.read(&out[0], len);
+    out.resize((size_t)fin.gcount());
+    return true;
+}
+
+static bool isCSourcePath(const filesystem::path &p) {
+    static const set<string> exts = {".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", ".inl"};
+    return exts.count(p.extension().string()) > 0;
+}
+
+// Directories are walked recursively for C/C++ sources (sorted, so the order is stable
+// across runs); plain files are taken as given.
+static vector<string> collectSourceFiles(const vector<string> &roots) {
+    vector<string> files;
+    for (auto &root : roots) {
+        error_code ec;
+        if (filesystem::is_directory(root, ec)) {
+            vector<string> found;
+            for (auto it = filesystem::recursive_directory_iterator(root, filesystem::directory_options::skip_permission_denied, ec);
+                 it != filesystem::recursive_directory_iterator(); it.increment(ec)) {
+                if (ec) break;
+                if (it->is_regular_file(ec) && isCSourcePath(it->path())) found.push_back(it->path().string());
+            }
+            sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(root);
+        }
+    }
+    return files;
+}
+
+static vector<string> readFileList(const string &listPath) {
+    vector<string> files;
+    ifstream fin(listPath);
+    string line;
+    while (getline(fin, line)) {
+        line = trim(line);
+        if (!line.empty()) files.push_back(line);
+    }
+    return files;
+}
+
+// Strips and tokenizes every file on a work-stealing pool. Files are started largest
+// first so one big file does not end up running alone at the tail; results come back
+// indexed in input order.
+static vector<LexFileResult> batchLex(const vector<string> &files, unsigned threads) {
+    vector<LexFileResult> results(files.size());
+    vector<pair<uintmax_t, size_t>> bySize;
+    for (size_t i = 0; i < files.size(); i++) {
+        error_code ec;
+        uintmax_t sz = filesystem::file_size(files[i], ec);
+        bySize.push_back({ec ? 0 : sz, i});
+    }
+    stable_sort(bySize.begin(), bySize.end(), [](auto &a, auto &b) { return a.first > b.first; });
+
+    WorkStealingPool pool((unsigned)min<size_t>(threads, files.size()));
+    for (auto &entry : bySize) {
+        size_t idx = entry.second;
+        pool.submit([&files, &results, idx] {
+            LexFileResult &r = results[idx];
+            string code;
+            if (!readWholeFile(files[idx], code)) return;
+            string cleaned = removeCComments(code);
+            r.ok = true;
+            r.bytes = code.size();
+            r.keptBytes = cleaned.size();
+            r.tokens = tokenizeC(cleaned).size();
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+static void runBatchLex(const vector<string> &files, unsigned threads, bool perFile) {
+    if (threads == 0) threads = defaultThreadCount();
+    threads = (unsigned)min<size_t>({threads, files.size(), WorkStealingPool::MAX_THREADS});
+    auto t0 = chrono::steady_clock::now();
+    vector<LexFileResult> results = batchLex(files, threads);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    size_t ok = 0, bytes = 0, kept = 0, tokens = 0;
+    if (perFile) {
+        cout << "\n--- Batch Lexing ---\n";
+        cout << left << setw(12) << "Bytes" << setw(12) << "Tokens" << "File\n";
+        cout << string(60, '-') << "\n";
+    }
+    for (size_t i = 0; i < files.size(); i++) {
+        const auto &r = results[i];
+        if (perFile) {
+            if (r.ok) cout << left << setw(12) << r.bytes << setw(12) << r.tokens << files[i] << "\n";
+            else cout << left << setw(24) << "(unreadable)" << files[i] << "\n";
+        }
+        if (!r.ok) continue;
+        ok++;
+        bytes += r.bytes;
+        kept += r.keptBytes;
+        tokens += r.tokens;
+    }
+
+    double mb = bytes / 1e6;
+    cout << "\nFiles: " << ok << " lexed, " << (files.size() - ok) << " unreadable\n";
+    cout << "Input: " << bytes << " bytes (" << kept << " after comment removal)\n";
+    cout << "Tokens: " << tokens << "\n";
+    cout << "Threads: " << threads << "\n";
+    cout << fixed << setprecision(3) << "Time: " << secs << " s\n";
+    cout << setprecision(1) << "Throughput: " << (secs > 0 ? mb / secs : 0.0) << " MB/s, "
+         << (secs > 0 ? tokens / secs / 1e6 : 0.0) << " Mtokens/s\n";
+    cout << defaultfloat << setprecision(6);
+}
+
+// ----------------------------- Batch Validation (Lab 09 over many inputs) -----------------------------
+// The grammar and table are built once and only read afterwards, so every task
+// shares them without locking; each task owns its QuietParser buffers. The text is
+// cut at line boundaries into a few chunks per thread and the per-chunk results are
+// merged in file order.
+static ParseRunStats parseLinesParallel(const Grammar &g,
+                                        const ParseTable &table,
+                                        string_view text,
+                                        unsigned threads,
+                                        size_t minChunk = 1u << 16) {
+    if (threads == 0) threads = defaultThreadCount();
+    threads = min(threads, WorkStealingPool::MAX_THREADS);
+    auto t0 = chrono::steady_clock::now();
+
+    size_t target = max(minChunk, text.size() / ((size_t)threads * 8) + 1);
+    vector<string_view> chunks;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = min(text.size(), pos + target);
+        if (end < text.size()) {
+            const void *nl = memchr(text.data() + end, '\n', text.size() - end);
+            end = nl ? (size_t)((const char *)nl - text.data()) + 1 : text.size();
+        }
+        chunks.push_back(text.substr(pos, end - pos));
+        pos = end;
+    }
+
+    vector<ParseRunStats> parts(chunks.size());
+    if (threads == 1 || chunks.size() == 1) {
+        QuietParser parser(g, table);
+        for (size_t i = 0; i < chunks.size(); i++) parseLineRange(parser, chunks[i], 1, parts[i]);
+    } else {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < chunks.size(); i++) {
+            pool.submit([&g, &table, &chunks, &parts, i] {
+                QuietParser parser(g, table);
+                parseLineRange(parser, chunks[i], 1, parts[i]);
+            });
+        }
+        pool.wait();
+    }
+
+    ParseRunStats st;
+    st.threads = threads;
+    size_t lineBase = 0;
+    for (auto &part : parts) {
+        st.lines += part.lines;
+        st.accepted += part.accepted;
+        st.rejected += part.rejected;
+        st.tokens += part.tokens;
+        st.bytes += part.bytes;
+        for (size_t ln : part.firstFailures)
+            if (st.firstFailures.size() < MAX_REPORTED_FAILURES) st.firstFailures.push_back(lineBase + ln);
+        lineBase += part.physicalLines;
+    }
+    st.physicalLines = lineBase;
+    st.seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    return st;
+}
+
+// ----------------------------- Synthetic Workloads -----------------------------
+// Seeded generators for inputs far larger than the built-in examples. SplitMix64
+// is used instead of <random> distributions so a seed gives the same output on
+// every standard library.
+struct SplitMix64 {
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) { return n ? (size_t)(next() % n) : 0; }
+    double unit() { return (double)(next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return unit() < p; }
+};
+
+struct GrammarGenOptions {
+    size_t nonterminals = 100;
+    size_t alternatives = 4;    // average per rule
+    size_t maxLength = 5;       // symbols per alternative
+    size_t terminals = 20;
+    double leftRecursion = 0.1; // share of alternatives that start with their own or an earlier nonterminal
+    double commonPrefix = 0.3;  // share of alternatives that reuse the start of an earlier sibling
+    uint64_t seed = 1;
+};
+
+// Rules N0 .. N(k-1) over terminals t0 .. t(m-1), N0 is the start symbol. Every rule's
+// first alternative starts with a terminal, and other alternatives only start with
+// a later nonterminal unless they are chosen to be left-recursive (directly, or via
+// an earlier nonterminal, which closes a left-corner cycle). Left-recursive
+// alternatives are never unit rules, so the grammar has no cycles A =>+ A.
+static string generateGrammarText(const GrammarGenOptions &opt) {
+    SplitMix64 rng(opt.seed);
+    size_t n = max<size_t>(1, opt.nonterminals), nt = max<size_t>(1, opt.terminals);
+    size_t maxLen = max<size_t>(2, opt.maxLength);
+    auto N = [](size_t i) { return "N" + to_string(i); };
+    auto T = [](size_t i) { return "t" + to_string(i); };
+    auto anySym = [&]() { return rng.chance(0.6) ? T(rng.below(nt)) : N(rng.below(n)); };
+
+    string text;
+    vector<vector<string>> alts;
+    for (size_t i = 0; i < n; i++) {
+        size_t count = max<size_t>(1, opt.alternatives / 2 + rng.below(opt.alternatives + 1));
+        alts.clear();
+        for (size_t k = 0; k < count; k++) {
+            vector<string> rhs;
+            size_t len = 1 + rng.below(maxLen);
+            if (k > 0 && rng.chance(opt.leftRecursion)) {
+                rhs.push_back(rng.chance(0.5) || i == 0 ? N(i) : N(rng.below(i)));
+                len = max<size_t>(len, 2);
+            } else if (k > 0 && rng.chance(opt.commonPrefix)) {
+                const vector<string> &sib = alts[rng.below(alts.size())];
+                size_t keep = 1 + rng.below(min<size_t>(sib.size(), 2));
+                rhs.assign(sib.begin(), sib.begin() + (long long)keep);
+            } else if (k == 0 || i + 1 == n || rng.chance(0.7)) {
+                rhs.push_back(T(rng.below(nt)));
+            } else {
+                rhs.push_back(N(i + 1 + rng.below(n - i - 1)));
+            }
+            while (rhs.size() < len) rhs.push_back(anySym());
+            alts.push_back(move(rhs));
+        }
+
+        text += N(i) + " ->";
+        for (size_t k = 0; k < alts.size(); k++) {
+            if (k) text += " |";
+            for (auto &sym : alts[k]) text += " " + sym;
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+static Grammar generateGrammar(const GrammarGenOptions &opt) {
+    Grammar g;
+    loadGrammarText(generateGrammarText(opt), g);
+    return g;
+}
+
+struct CSourceGenOptions {
+    size_t bytes = 1 << 20;
+    double comments = 0.15;     // share of lines that are (or carry) comments
+    double strings = 0.1;       // chance of a string or char literal per operand
+    double operators = 0.5;     // chance of continuing an expression with another operator
+    double preprocessor = 0.05; // share of #include / #define lines
+    uint64_t seed = 1;
+};
+
+// C-like text: functions made of declarations, assignments, calls, ifs and loops,
+// with the requested mix of comments (line and block, some mid-line), string and
+// char literals (with escapes and comment markers inside), operators and
+// preprocessor lines. It is lexically valid C, not meant to compile.
+static string generateCSource(const CSourceGenOptions &opt) {
+    SplitMix64 rng(opt.seed);
+    static const char *const types[] = {"int", "char", "long", "double", "unsigned", "float", "short"};
+    static const char *const ops[] = {"+", "-", "*", "/", "%", "<<", ">>", "&", "|", "^", "&&", "||",
+                                      "==", "!=", "<", "<=", ">", ">=", "->", "."};
+    static const char *const words[] = {"alpha", "beta", "count", "value", "node", "buf", "len", "idx",
+                                        "state", "next", "prev", "total", "flag", "ptr", "data", "size"};
+    auto ident = [&]() { return string(words[rng.below(16)]) + (rng.chance(0.5) ? to_string(rng.below(100)) : ""); };
+    auto literal = [&]() -> string {
+        if (rng.chance(0.7)) return "\"text " + to_string(rng.below(1000)) + (rng.chance(0.3) ? " /* not */ \\\"q\\\"" : "") + "\\n\"";
+        return rng.chance(0.5) ? "'x'" : "'\\n'";
+    };
+    auto operand = [&]() -> string {
+        if (rng.chance(opt.strings)) return literal();
+        if (rng.chance(0.3)) return to_string(rng.below(100000)) + (rng.chance(0.2) ? ".5" : "");
+        return ident();
+    };
+    auto expr = [&]() {
+        string e = operand();
+        while (rng.chance(opt.operators)) e += string(" ") + ops[rng.below(20)] + " " + operand();
+        return e;
+    };
+    auto comment = [&]() -> string {
+        if (rng.chance(0.6)) return "// note " + to_string(rng.below(1000)) + ": keep \"quotes\" and /* here */";
+        return "/* block " + to_string(rng.below(1000)) + "\n   spans lines // with a slash pair\n */";
     };
 
-    static const vector<string> ops3 = {"<<=", ">>=", "..."};
-    static const vector<string> ops2 = {
-        "++","--","==","!=","<=",">=","&&","||","+=","-=","*=","/=","%=",
-        "<<",">>","->","::","&=","|=","^=","##"
-    };
-    static const unordered_set<char> seps = {';',',','(',')','{','}','[',']',':','?','.'};
+    string out;
+    out.reserve(opt.bytes + 256);
+    size_t fn = 0;
+    while (out.size() < opt.bytes) {
+        if (rng.chance(opt.preprocessor * 4)) {
+            out += rng.chance(0.5) ? "#include <header" + to_string(rng.below(50)) + ".h>\n"
+                                   : "#define MACRO_" + to_string(rng.below(500)) + " (" + expr() + ")\n";
+        }
+        out += string(types[rng.below(7)]) + " fn" + to_string(fn++) + "(int a, char *b) {\n";
+        size_t stmts = 4 + rng.below(12);
+        for (size_t k = 0; k < stmts; k++) {
+            if (rng.chance(opt.comments)) out += "    " + comment() + "\n";
+            switch (rng.below(5)) {
+                case 0: out += string("    ") + types[rng.below(7)] + " " + ident() + " = " + expr() + ";"; break;
+                case 1: out += "    " + ident() + " = " + expr() + ";"; break;
+                case 2: out += "    " + ident() + "(" + expr() + ", " + operand() + ");"; break;
+                case 3: out += "    if (" + expr() + ") { " + ident() + "++; } else { return " + operand() + "; }"; break;
+                default: out += "    for (int i = 0; i < " + operand() + "; i++) " + ident() + " += " + expr() + ";"; break;
+            }
+            if (rng.chance(opt.comments / 2)) out += " /* trailing */";
+            out += "\n";
+        }
+        out += "    return 0;\n}\n\n";
+    }
+    return out;
+}
 
-    for (size_t i = 0; i < code.size();) {
-        char c = code[i];
+// ----------------------------- Benchmark Suite -----------------------------
+// Every stage runs on inputs of growing size: `warmup` untimed runs, then `reps`
+// timed ones. Inputs are prepared by the caller and any per-run copy (grammars are
+// edited in place) is made outside the timed region. Results are written as JSON.
+struct BenchResult {
+    string stage, input, unit;
+    size_t units = 0;
+    vector<double> samples; // seconds, sorted
+};
 
-        if (c == '\n') { line++; i++; continue; }
-        if (isspace((unsigned char)c)) { i++; continue; }
+struct BenchConfig {
+    int warmup = 2, reps = 11;
+    bool quick = false;
+    uint64_t seed = 1;
+};
 
-        // Preprocessor (if # at beginning of line or after spaces)
-        if (c == '#') {
-            size_t j = i;
-            while (j < code.size() && code[j] != '\n') j++;
-            push(TokType::PREPROCESSOR, code.substr(i, j - i));
-            i = j;
-            continue;
-        }
+static volatile size_t benchSink; // keeps results observable
+
+template <class Setup, class Body>
+static BenchResult runBench(const BenchConfig &cfg,
+                            const string &stage,
+                            const string &input,
+                            size_t units,
+                            const string &unit,
+                            Setup &&setup,
+                            Body &&body) {
+    BenchResult r{stage, input, unit, units, {}};
+    for (int i = 0; i < cfg.warmup + cfg.reps; i++) {
+        setup();
+        auto t0 = chrono::steady_clock::now();
+        benchSink = body();
+        double dt = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if (i >= cfg.warmup) r.samples.push_back(dt);
+    }
+    sort(r.samples.begin(), r.samples.end());
+    cerr << "  " << left << setw(30) << stage << setw(20) << input << right << setw(12) << fixed
+         << setprecision(3) << r.samples[r.samples.size() / 2] * 1e3 << " ms\n";
+    cerr.unsetf(ios::floatfield);
+    return r;
+}
 
-        // Identifier/Keyword
-        if (isalpha((unsigned char)c) || c == '_') {
-            size_t j = i;
-            while (j < code.size() && (isalnum((unsigned char)code[j]) || code[j] == '_')) j++;
-            string w = code.substr(i, j - i);
-            push(isKeyword(w) ? TokType::KEYWORD : TokType::IDENTIFIER, w);
-            i = j;
-            continue;
-        }
+static double percentile(const vector<double> &sorted, double q) {
+    size_t k = (size_t)ceil(q * (double)sorted.size());
+    return sorted[k ? k - 1 : 0];
+}
 
-        // Number
-        if (isdigit((unsigned char)c)) {
-            size_t j = i;
-            bool dot = false;
-            while (j < code.size()) {
-                char d = code[j];
-                if (isdigit((unsigned char)d)) { j++; continue; }
-                if (d == '.' && !dot) { dot = true; j++; continue; }
-                if ((d=='e' || d=='E') && j+1 < code.size()) {
-                    j++;
-                    if (code[j]=='+' || code[j]=='-') j++;
-                    continue;
-                }
-                break;
-            }
-            push(TokType::NUMBER, code.substr(i, j - i));
-            i = j;
-            continue;
-        }
+static void writeBenchJson(ostream &out, const BenchConfig &cfg, const vector<BenchResult> &results) {
+    out << "{\n  \"suite\": \"mini_compiler\",\n  \"warmup\": " << cfg.warmup << ",\n  \"repetitions\": " << cfg.reps
+        << ",\n  \"results\": [\n";
+    out << fixed << setprecision(1);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        double med = percentile(r.samples, 0.5), mean = 0;
+        for (double x : r.samples) mean += x;
+        mean /= (double)r.samples.size();
+        out << "    {\"stage\": \"" << r.stage << "\", \"input\": \"" << r.input << "\", \"units\": " << r.units
+            << ", \"unit\": \"" << r.unit << "\", \"median_ns\": " << med * 1e9
+            << ", \"p99_ns\": " << percentile(r.samples, 0.99) * 1e9 << ", \"min_ns\": " << r.samples.front() * 1e9
+            << ", \"mean_ns\": " << mean * 1e9 << ", \"ns_per_unit\": " << setprecision(3)
+            << (r.units ? med * 1e9 / (double)r.units : 0.0) << ", \"units_per_sec\": " << setprecision(1)
+            << (med > 0 ? (double)r.units / med : 0.0) << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
 
-        // String literal
-        if (c == '"') {
-            size_t j = i + 1;
-            bool esc = false;
-            while (j < code.size()) {
-                char d = code[j];
-                if (d == '\n') line++;
-                if (!esc && d == '"') { j++; break; }
-                esc = (!esc && d == '\\');
-                j++;
-            }
-            push(TokType::STRING_LIT, code.substr(i, j - i));
-            i = j;
-            continue;
-        }
+static size_t benchProductions(const Grammar &g) {
+    size_t n = 0;
+    for (Sym A : g.nonterminals) n += g.prod[(size_t)A].size();
+    return n;
+}
 
-        // Char literal
-        if (c == '\'') {
-            size_t j = i + 1;
-            bool esc = false;
-            while (j < code.size()) {
-                char d = code[j];
-                if (d == '\n') line++;
-                if (!esc && d == '\'') { j++; break; }
-                esc = (!esc && d == '\\');
-                j++;
-            }
-            push(TokType::CHAR_LIT, code.substr(i, j - i));
-            i = j;
-            continue;
-        }
+// Inputs come from the synthetic generators: C sources from 64 KiB to 8 MiB and
+// grammars with 10x to 1000x the nonterminals of the expression grammar.
+static vector<BenchResult> runBenchmarks(const BenchConfig &cfg) {
+    vector<BenchResult> res;
+    vector<size_t> srcSizes = cfg.quick ? vector<size_t>{1 << 14, 1 << 18} : vector<size_t>{1 << 16, 1 << 20, 1 << 23};
+    vector<size_t> gramSizes = cfg.quick ? vector<size_t>{30, 300} : vector<size_t>{30, 300, 3000};
+    vector<size_t> exprSizes = cfg.quick ? vector<size_t>{1000, 10000} : vector<size_t>{1000, 10000, 100000};
+
+    for (size_t bytes : srcSizes) {
+        CSourceGenOptions copt;
+        copt.bytes = bytes;
+        copt.seed = cfg.seed;
+        string code = generateCSource(copt), cleaned = removeCComments(code);
+        string tag = "c-source/" + to_string(bytes);
+        auto none = [] {};
+        res.push_back(runBench(cfg, "removeCComments", tag, code.size(), "bytes", none,
+                               [&] { return removeCComments(code).size(); }));
+        res.push_back(runBench(cfg, "tokenizeC", tag, cleaned.size(), "bytes", none,
+                               [&] { return tokenizeC(cleaned).size(); }));
+        vector<string_view> words;
+        for (const Token &t : tokenizeC(cleaned))
+            if (t.type == TokType::IDENTIFIER || t.type == TokType::KEYWORD) words.push_back(t.lexeme);
+        res.push_back(runBench(cfg, "isKeyword", tag, words.size(), "lookups", none, [&] {
+            size_t n = 0;
+            for (string_view w : words) n += isKeyword(w);
+            return n;
+        }));
+    }
 
-        // Operators (3-char then 2-char then 1-char)
-        bool matched = false;
-        if (i + 2 < code.size()) {
-            string t3 = code.substr(i, 3);
-            for (auto &op : ops3) {
-                if (t3 == op) {
-                    push(TokType::OPERATOR, t3);
-                    i += 3;
-                    matched = true;
-                    break;
-                }
-            }
-            if (matched) continue;
+    for (size_t nts : gramSizes) {
+        string tag = "grammar/" + to_string(nts);
+        GrammarGenOptions gopt;
+        gopt.nonterminals = nts;
+        gopt.terminals = max<size_t>(8, nts / 10);
+        gopt.seed = cfg.seed;
+
+        GrammarGenOptions fopt = gopt;
+        fopt.leftRecursion = 0;
+        fopt.commonPrefix = 0.6;
+        Grammar fact = generateGrammar(fopt), work;
+        auto copyFact = [&] { work = fact; };
+        res.push_back(runBench(cfg, "leftFactor", tag, benchProductions(fact), "productions", copyFact, [&] {
+            leftFactor(work);
+            return work.nonterminals.size();
+        }));
+
+        Grammar src = generateGrammar(gopt);
+        auto copySrc = [&] { work = src; };
+        // the unscoped algorithm substitutes across all pairs and blows up on the
+        // largest grammars, so it is only timed up to a few hundred nonterminals
+        if (nts <= 300) {
+            res.push_back(runBench(cfg, "eliminateLeftRecursion", tag, benchProductions(src), "productions",
+                                   copySrc, [&] {
+                                       eliminateLeftRecursion(work);
+                                       return work.nonterminals.size();
+                                   }));
         }
-        if (i + 1 < code.size()) {
-            string t2 = code.substr(i, 2);
-            for (auto &op : ops2) {
-                if (t2 == op) {
-                    push(TokType::OPERATOR, t2);
-                    i += 2;
-                    matched = true;
-                    break;
-                }
+        res.push_back(runBench(cfg, "eliminateLeftRecursionScoped", tag, benchProductions(src), "productions",
+                               copySrc, [&] { return eliminateLeftRecursionScoped(work, 0).productionsAfter; }));
+        LRTable lr; // bottom-up: straight from the unrewritten grammar
+        res.push_back(runBench(cfg, "buildLRTable", tag, benchProductions(src), "productions", [] {}, [&] {
+            buildLRTable(src, LRMode::LALR, lr);
+            return lr.states();
+        }));
+
+        Grammar g = src;
+        eliminateLeftRecursionScoped(g, 0);
+        leftFactor(g);
+        g.recomputeSymbols();
+        size_t prods = benchProductions(g);
+        SymbolSets FIRST, FOLLOW;
+        auto none = [] {};
+        res.push_back(runBench(cfg, "computeFIRST", tag, prods, "productions", none, [&] {
+            computeFIRST(g, FIRST);
+            return FIRST.rowWords();
+        }));
+        res.push_back(runBench(cfg, "computeFOLLOW", tag, prods, "productions", none, [&] {
+            computeFOLLOW(g, FIRST, FOLLOW);
+            return FOLLOW.rowWords();
+        }));
+        ParseTable table;
+        vector<Sym> cols;
+        res.push_back(runBench(cfg, "buildParseTable", tag, prods, "productions", none, [&] {
+            buildParseTable(g, FIRST, FOLLOW, table, cols);
+            return table.slots.size();
+        }));
+
+        // Each edit pair adds a new production over existing symbols and removes it
+        // again, so every repetition starts from the same analysis. A draw that equals an
+        // existing alternative is skipped: removing it would take out the original.
+        IncrementalAnalysis inc(g);
+        SplitMix64 rng(cfg.seed);
+        vector<pair<Sym, vector<Sym>>> edits;
+        for (size_t tries = 0; edits.size() < 32 && tries < 32 * 8; tries++) {
+            pair<Sym, vector<Sym>> e;
+            e.first = g.nonterminals[rng.next() % g.nonterminals.size()];
+            for (size_t k = rng.next() % 3; k-- > 0;) {
+                bool nt = rng.next() % 2 || g.terminals.empty();
+                e.second.push_back(nt ? g.nonterminals[rng.next() % g.nonterminals.size()]
+                                      : g.terminals[rng.next() % g.terminals.size()]);
             }
-            if (matched) continue;
-        }
-
-        // Separators
-        if (seps.count(c)) {
-            push(TokType::SEPARATOR, string(1, c));
-            i++;
-            continue;
-        }
-
-        // Single char operators fallback
-        if (string("+-*/%<>=!&|^~").find(c) != string::npos) {
-            push(TokType::OPERATOR, string(1, c));
-            i++;
-            continue;
+            if (e.second.empty()) e.second.push_back(SYM_EPS);
+            const auto &alts = g.prod[(size_t)e.first];
+            if (find(alts.begin(), alts.end(), e.second) == alts.end()) edits.push_back(move(e));
         }
-
-        // Unknown
-        push(TokType::UNKNOWN, string(1, c));
-        i++;
+        res.push_back(runBench(cfg, "incrementalEdit", tag, edits.size() * 2, "edits", none, [&] {
+            size_t cells = 0;
+            for (auto &e : edits) {
+                cells += inc.addProduction(e.first, e.second).cells.size();
+                cells += inc.removeProduction(e.first, e.second).cells.size();
+            }
+            return cells;
+        }));
     }
 
-    return tokens;
+    Grammar g;
+    ParseTable table;
+    buildExprParser(g, table);
+    QuietParser quiet(g, table);
+    Grammar exprLR = defaultExprGrammarLeftRecursive();
+    LRTable lr;
+    buildLRTable(exprLR, LRMode::LALR, lr);
+    for (size_t terms : exprSizes) {
+        string expr = "id";
+        for (size_t i = 1; i < terms; i++) expr += (i % 3 == 0) ? "*(id+id)" : (i % 2 ? "+id" : "*id");
+        quiet.parse(expr);
+        size_t toks = quiet.lastTokens();
+        string tag = "expr/" + to_string(toks);
+        auto none = [] {};
+        res.push_back(runBench(cfg, "predictiveParse", tag, toks, "tokens", none,
+                               [&] { return (size_t)predictiveParse(g, table, expr, false); }));
+        res.push_back(runBench(cfg, "QuietParser", tag, toks, "tokens", none,
+                               [&] { return (size_t)quiet.parse(expr); }));
+        res.push_back(runBench(cfg, "lrParse", tag, toks, "tokens", none,
+                               [&] { return (size_t)lrParse(exprLR, lr, expr, false); }));
+    }
+    return res;
 }
 
 // ----------------------------- Input Helpers -----------------------------
-static string readFromFileOrPaste() {
+static int askInputMethod() {
     cout << "\nChoose input method:\n";
     cout << "1) Read from file path\n";
     cout << "2) Paste text (end with a single line: ###END###)\n";
@@ -1065,11 +4917,85 @@ static string readFromFileOrPaste() {
     int ch;
     cin >> ch;
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    return ch;
+}
+
+static string askFilePath() {
+    cout << "Enter file path: ";
+    string path;
+    getline(cin, path);
+    return path;
+}
+
+// Whole-string unsigned option value that fits T; false on junk, signs or overflow.
+template <class T>
+static bool parseCountArg(const string &s, T &out) {
+    if (s.empty() || !isdigit((unsigned char)s[0])) return false;
+    errno = 0;
+    char *end = nullptr;
+    unsigned long long v = strtoull(s.c_str(), &end, 10);
+    if (errno || *end || v > (unsigned long long)numeric_limits<T>::max()) return false;
+    out = (T)v;
+    return true;
+}
+
+// Reads one count with the parseCountArg rules; an empty answer leaves 0.
+template <class T>
+static bool askCount(const char *prompt, const char *what, T &out) {
+    cout << prompt;
+    string line;
+    getline(cin, line);
+    line = trim(line);
+    out = 0;
+    if (line.empty() || parseCountArg(line, out)) return true;
+    cerr << "Invalid " << what << ": '" << line << "'\n";
+    return false;
+}
+
+// Same rules as --threads; an empty answer means all cores.
+static bool askThreadCount(unsigned &threads) {
+    return askCount("Threads (0 = all cores): ", "thread count", threads);
+}
+
+static void printGrammarLoadResult(const GrammarLoadResult &res) {
+    const size_t shown = 20;
+    for (size_t i = 0; i < res.errors.size() && i < shown; i++) cerr << "  " << res.errors[i] << "\n";
+    if (res.errors.size() > shown) cerr << "  ... " << res.errors.size() - shown << " more\n";
+    cout << "Loaded " << res.rules << " rules (" << res.productions << " productions) from " << res.lines
+         << " lines in " << fixed << setprecision(2) << res.seconds * 1e3 << " ms";
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    if (!res.errors.empty()) cout << ", " << res.errors.size() << " bad lines skipped";
+    cout << "\n";
+}
+
+static Grammar readGrammarFromFile() {
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    string path = trim(askFilePath());
+    Grammar g;
+    string text;
+    if (!readWholeFile(path, text)) {
+        cerr << "Could not open file.\n";
+        return g;
+    }
+    printGrammarLoadResult(loadGrammarText(text, g));
+    return g;
+}
+
+static string readPastedText() {
+    cout << "Paste now. Finish by typing: ###END### on its own line.\n";
+    string line, all;
+    while (true) {
+        if (!getline(cin, line)) break;
+        if (line == "###END###") break;
+        all += line + "\n";
+    }
+    return all;
+}
 
-    if (ch == 1) {
-        cout << "Enter file path: ";
-        string path;
-        getline(cin, path);
+static string readFromFileOrPaste() {
+    if (askInputMethod() == 1) {
+        string path = askFilePath();
         ifstream fin(path);
         if (!fin) {
             cerr << "Could not open file.\n";
@@ -1079,21 +5005,28 @@ static string readFromFileOrPaste() {
         ss << fin.rdbuf();
         return ss.str();
     } else {
-        cout << "Paste now. Finish by typing: ###END### on its own line.\n";
-        string line, all;
-        while (true) {
-            if (!getline(cin, line)) break;
-            if (line == "###END###") break;
-            all += line + "\n";
-        }
-        return all;
+        return readPastedText();
     }
 }
 
 // ----------------------------- Menu Actions -----------------------------
 static void Case01() {
     cout << "\n[Lab 01] Comment Removal\n";
-    string code = readFromFileOrPaste();
+    if (askInputMethod() == 1) {
+        // Files are streamed through the stripper, never loaded whole.
+        string path = askFilePath();
+        ifstream fin(path);
+        if (!fin) {
+            cerr << "Could not open file.\n";
+            return;
+        }
+        if (fin.peek() == EOF) return;
+        cout << "\n--- Code (Comments Removed) ---\n";
+        removeCCommentsStream(fin, cout);
+        cout << "\n";
+        return;
+    }
+    string code = readPastedText();
     if (code.empty()) return;
     string cleaned = removeCComments(code);
     cout << "\n--- Code (Comments Removed) ---\n";
@@ -1105,7 +5038,7 @@ static void Case02() {
     string code = readFromFileOrPaste();
     if (code.empty()) return;
     string cleaned = removeCComments(code);
-    auto toks = tokenizeC(cleaned);
+    auto toks = tokenizeCParallel(cleaned, 0); // serial below a couple of MB
 
     cout << "\n--- Tokens ---\n";
     cout << left << setw(6) << "Line" << setw(18) << "Type" << "Lexeme\n";
@@ -1119,12 +5052,14 @@ static void Case03() {
     cout << "\n[Lab 03] Left Factoring\n";
     cout << "1) Use default example (if-then-else)\n";
     cout << "2) Enter your own grammar\n";
+    cout << "3) Load grammar from file\n";
     cout << "Choice: ";
     int ch;
     cin >> ch;
 
     Grammar g;
     if (ch == 1) g = defaultLeftFactoringExample();
+    else if (ch == 3) g = readGrammarFromFile();
     else g = readGrammarFromUser();
 
     cout << "\nBefore Left Factoring:\n";
@@ -1142,135 +5077,531 @@ static void Case04() {
     cout << "\n[Lab 05] Left Recursion Elimination\n";
     cout << "1) Use default expression grammar (left-recursive)\n";
     cout << "2) Enter your own grammar\n";
+    cout << "3) Load grammar from file\n";
     cout << "Choice: ";
     int ch;
     cin >> ch;
 
     Grammar g;
     if (ch == 1) g = defaultExprGrammarLeftRecursive();
+    else if (ch == 3) g = readGrammarFromFile();
     else g = readGrammarFromUser();
 
+    cout << "\nMode:\n";
+    cout << "1) Standard (substitute every earlier nonterminal)\n";
+    cout << "2) SCC-scoped (only inside left-recursive components, with a production budget)\n";
+    cout << "Choice: ";
+    int mode;
+    cin >> mode;
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    size_t budget = 0;
+    if (mode == 2 && !askCount("Production budget (0 = unlimited): ", "production budget", budget)) return;
+
     cout << "\nBefore elimination:\n";
     g.recomputeSymbols();
     g.print();
 
-    eliminateLeftRecursion(g);
+    LeftRecursionReport rep;
+    if (mode == 2) rep = eliminateLeftRecursionScoped(g, budget);
+    else eliminateLeftRecursion(g);
 
     cout << "\nAfter elimination:\n";
     g.recomputeSymbols();
     g.print();
+    if (mode == 2) printLeftRecursionReport(g, rep);
 }
 
-static void askAndMaybePreprocess(Grammar &g) {
+static bool askPreprocess() {
     cout << "\nPreprocess grammar before calculation?\n";
     cout << "1) Yes (Eliminate Left Recursion + Left Factoring)  [Recommended]\n";
     cout << "2) No  (Use grammar as entered)\n";
     cout << "Choice: ";
     int p;
     cin >> p;
-
-    if (p == 1) {
-        eliminateLeftRecursion(g);
-        leftFactor(g);
-    }
-    g.recomputeSymbols();
+    return p == 1;
 }
 
-static Grammar chooseGrammarForAnalysis(const string &labName, bool offerDefaultExpr = true) {
+// Reads the grammar and the preprocessing choice, then runs (or loads from the
+// analysis cache) preprocessing, FIRST, FOLLOW and the LL(1) table.
+static void chooseGrammarForAnalysis(const string &labName, GrammarAnalysis &an, bool offerDefaultExpr = true) {
     cout << "\n[" << labName << "] Choose grammar source:\n";
     if (offerDefaultExpr) {
         cout << "1) Use default expression grammar (E,T,F)\n";
         cout << "2) Enter your own grammar\n";
+        cout << "3) Load grammar from file\n";
         cout << "Choice: ";
         int ch;
         cin >> ch;
 
         Grammar g;
         if (ch == 1) g = defaultExprGrammarLeftRecursive();
+        else if (ch == 3) g = readGrammarFromFile();
         else g = readGrammarFromUser();
 
-        askAndMaybePreprocess(g);
-        return g;
+        bool pre = askPreprocess();
+        analyseGrammarCached(move(g), pre, an);
     } else {
         // fallback if someday you want custom-only
         Grammar g = readGrammarFromUser();
-        askAndMaybePreprocess(g);
-        return g;
+        bool pre = askPreprocess();
+        analyseGrammarCached(move(g), pre, an);
     }
 }
 
 static void Case05() {
     cout << "\n[Lab 06 & 07] FIRST and FOLLOW\n";
 
-    Grammar g = chooseGrammarForAnalysis("Lab 06 & 07: FIRST and FOLLOW", true);
-    g.print();
-
-    map<string, set<string>> FIRST, FOLLOW;
-    computeFIRST(g, FIRST);
-    computeFOLLOW(g, FIRST, FOLLOW);
+    GrammarAnalysis an;
+    chooseGrammarForAnalysis("Lab 06 & 07: FIRST and FOLLOW", an, true);
+    an.g.print();
 
-    printFIRSTFOLLOW(g, FIRST, FOLLOW);
+    printFIRSTFOLLOW(an.g, an.FIRST, an.FOLLOW);
 }
 
 static void Case06() {
     cout << "\n[Lab 08] LL(1) Parsing Table\n";
 
-    Grammar g = chooseGrammarForAnalysis("Lab 08: LL(1) Parsing Table", true);
+    GrammarAnalysis an;
+    chooseGrammarForAnalysis("Lab 08: LL(1) Parsing Table", an, true);
+    an.g.print();
+
+    printParseTable(an.g, an.table, an.cols);
+}
+
+static void Case07() {
+    cout << "\n[Lab 09] Predictive Parser (Expression Grammar)\n";
+    Grammar g;
+    ParseTable table;
+    buildExprParser(g, table, true);
     g.print();
 
-    map<string, set<string>> FIRST, FOLLOW;
-    computeFIRST(g, FIRST);
-    computeFOLLOW(g, FIRST, FOLLOW);
+    if (table.conflict) {
+        cout << "\nCannot safely run predictive parser: table has conflicts (not LL(1)).\n";
+        return;
+    }
+
+    cout << "\n1) Parse one string (step-by-step)\n";
+    cout << "2) Quiet mode: validate a file, one expression per line (parallel)\n";
+    cout << "3) Streaming mode: the whole file is one expression (bounded memory)\n";
+    cout << "4) Parse one string and print its parse tree\n";
+    cout << "Choice: ";
+    int ch;
+    cin >> ch;
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    if (ch == 2) {
+        string text;
+        if (!readWholeFile(trim(askFilePath()), text)) {
+            cerr << "Could not open file.\n";
+            return;
+        }
+        unsigned threads = 0;
+        if (!askThreadCount(threads)) return;
+        printParseRunStats(parseLinesParallel(g, table, text, threads));
+        return;
+    }
+    if (ch == 3) {
+        ifstream fin(trim(askFilePath()), ios::binary);
+        if (!fin) {
+            cerr << "Could not open file.\n";
+            return;
+        }
+        printStreamParseResult(parseExpressionStream(g, table, fin));
+        return;
+    }
+
+    cout << "\nEnter input string (default: id+id*id). Just press Enter to use default:\n> ";
+    string s;
+    getline(cin, s);
+    if (trim(s).empty()) s = "id+id*id";
+
+    if (ch == 4) {
+        ParseTree tree;
+        bool ok = buildParseTree(g, table, s, tree);
+        cout << "\n--- Parse Tree ---\n";
+        tree.print(g, cout);
+        cout << "\nNodes: " << tree.nodes.size() << " (" << tree.arenaBytes() << " bytes of arena)\n";
+        cout << "RESULT: " << (ok ? "String ACCEPTED" : "String REJECTED (partial tree)") << "\n";
+        return;
+    }
 
-    map<string, map<string, ParseTableCell>> table;
-    vector<string> cols;
-    buildParseTable(g, FIRST, FOLLOW, table, cols);
+    bool ok = predictiveParse(g, table, s, true);
+    cout << "\nRESULT: " << (ok ? "String ACCEPTED" : "String REJECTED") << "\n";
+}
 
-    printParseTable(g, table, cols);
+static void Case08() {
+    cout << "\n[Batch] Parallel comment removal + tokenizing\n";
+    cout << "1) Directory (searched recursively for C/C++ sources)\n";
+    cout << "2) File list (one path per line)\n";
+    cout << "Choice: ";
+    int ch;
+    cin >> ch;
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    cout << "Enter path: ";
+    string path;
+    getline(cin, path);
+    unsigned threads = 0;
+    if (!askThreadCount(threads)) return;
+
+    vector<string> files = (ch == 2) ? readFileList(trim(path)) : collectSourceFiles({trim(path)});
+    if (files.empty()) {
+        cout << "No input files found.\n";
+        return;
+    }
+    runBatchLex(files, threads, true);
 }
 
-static void Case07() {
-    cout << "\n[Lab 09] Predictive Parser (Expression Grammar)\n";
-    Grammar g = defaultExprGrammarLeftRecursive();
-    eliminateLeftRecursion(g);
-    leftFactor(g);
-    g.recomputeSymbols();
+static void Case09() {
+    cout << "\n[Generator] Emit a standalone LL(1) parser (C++ header)\n";
+
+    GrammarAnalysis an;
+    chooseGrammarForAnalysis("Parser Generator", an, true);
+    const Grammar &g = an.g;
+    const ParseTable &table = an.table;
+    const vector<Sym> &cols = an.cols;
     g.print();
 
-    map<string, set<string>> FIRST, FOLLOW;
-    computeFIRST(g, FIRST);
-    computeFOLLOW(g, FIRST, FOLLOW);
+    if (table.conflict || g.start < 0) {
+        cout << "\nCannot generate a parser: table has conflicts (not LL(1)).\n";
+        return;
+    }
 
-    map<string, map<string, ParseTableCell>> table;
-    vector<string> cols;
-    buildParseTable(g, FIRST, FOLLOW, table, cols);
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    cout << "Output header (default: ll1_parser.hpp): ";
+    string path;
+    getline(cin, path);
+    path = trim(path);
+    if (path.empty()) path = "ll1_parser.hpp";
+    cout << "Namespace (default: ll1): ";
+    string ns;
+    getline(cin, ns);
+    ns = trim(ns);
+    if (ns.empty()) {
+        ns = "ll1";
+    } else if (!isCppIdentifier(ns)) {
+        cout << "'" << ns << "' is not a valid C++ namespace name (or is reserved), using ll1.\n";
+        ns = "ll1";
+    }
 
-    // quick conflict check
-    bool hasConflict = false;
-    for (auto &A : g.nonterminals)
-        for (auto &t : cols)
-            if (table[A][t].conflict) hasConflict = true;
+    ofstream out(path);
+    if (!out || !emitParserHeader(g, table, cols, ns, out)) {
+        cout << "Could not write " << path << "\n";
+        return;
+    }
+    cout << "Wrote " << path << " (namespace " << ns << ", " << table.prodRhs.size() << " productions, "
+         << table.slots.size() << " table slots for " << g.nonterminals.size() << "x" << cols.size() << " cells)\n";
+}
 
-    if (hasConflict) {
-        cout << "\nCannot safely run predictive parser: table has conflicts (not LL(1)).\n";
+static void Case10() {
+    cout << "\n[Lab 10] LR Parser (SLR(1) / LALR(1))\n";
+    cout << "\n[Lab 10: LR Parsing] Choose grammar source:\n";
+    cout << "1) Use default expression grammar (E,T,F), left-recursive, no rewriting\n";
+    cout << "2) Enter your own grammar\n";
+    cout << "3) Load grammar from file\n";
+    cout << "Choice: ";
+    int ch;
+    cin >> ch;
+    Grammar g;
+    if (ch == 1) g = defaultExprGrammarLeftRecursive();
+    else if (ch == 3) g = readGrammarFromFile();
+    else g = readGrammarFromUser();
+    if (g.start < 0) {
+        cout << "\nGrammar is empty.\n";
         return;
     }
 
+    cout << "\nTable:\n";
+    cout << "1) LALR(1)  [Recommended]\n";
+    cout << "2) SLR(1)\n";
+    cout << "Choice: ";
+    int m;
+    cin >> m;
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    g.print();
+
+    LRTable table;
+    buildLRTable(g, m == 2 ? LRMode::SLR : LRMode::LALR, table);
+    bool small = table.states() <= 40 && g.terminals.size() + g.nonterminals.size() <= 16;
+    printLRTable(g, table, small);
+
     cout << "\nEnter input string (default: id+id*id). Just press Enter to use default:\n> ";
     string s;
     getline(cin, s);
     if (trim(s).empty()) s = "id+id*id";
-
-    bool ok = predictiveParse(g, table, s, true);
+    bool ok = lrParse(g, table, s, true);
     cout << "\nRESULT: " << (ok ? "String ACCEPTED" : "String REJECTED") << "\n";
 }
 
+static void printEditReport(const Grammar &g, const IncrementalAnalysis::EditReport &rep, double ms) {
+    if (!rep.applied) {
+        cout << "No change (unknown production or malformed edit).\n";
+        return;
+    }
+    if (rep.fullRebuild)
+        cout << "Full rebuild (the edit introduced a symbol): " << rep.rowsRebuilt << " table rows";
+    else
+        cout << "FIRST rows changed: " << rep.firstChanged << ", FOLLOW rows changed: " << rep.followChanged
+             << ", table rows rebuilt: " << rep.rowsRebuilt;
+    cout << "  [" << fixed << setprecision(3) << ms << " ms]\n";
+    cout << defaultfloat << setprecision(6);
+
+    const size_t shown = 20;
+    for (size_t i = 0; i < rep.cells.size() && i < shown; i++) {
+        const auto &c = rep.cells[i];
+        cout << "  M[" << g.name(c.A) << ", " << g.name(c.a) << "]: "
+             << (c.before.empty() ? "." : c.before) << "  =>  " << (c.after.empty() ? "." : c.after);
+        if (c.after == "CONFLICT" && c.before != "CONFLICT") cout << "   <-- new conflict";
+        cout << "\n";
+    }
+    if (rep.cells.size() > shown) cout << "  ... " << rep.cells.size() - shown << " more changed cells\n";
+    if (rep.cells.empty()) cout << "  No table cells changed.\n";
+}
+
+static void Case11() {
+    cout << "\n[Tuning] Incremental grammar editing\n";
+
+    GrammarAnalysis an;
+    chooseGrammarForAnalysis("Incremental Editing", an, true);
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    IncrementalAnalysis inc(move(an));
+    inc.grammar().print();
+    cout << "\nConflicting cells: " << inc.conflicts() << "\n";
+
+    cout << "\nOne edit per line, empty line to finish:\n";
+    cout << "  + A -> alpha    add a production (A -> x | y adds both)\n";
+    cout << "  - A -> alpha    remove a production\n";
+    cout << "  table           print the current LL(1) table\n";
+    cout << "  grammar         print the current grammar\n";
+    string line;
+    while (true) {
+        cout << "> ";
+        if (!getline(cin, line)) break;
+        line = trim(line);
+        if (line.empty()) break;
+        if (line == "table") {
+            ParseTable table;
+            vector<Sym> cols;
+            inc.exportTable(table, cols);
+            printParseTable(inc.grammar(), table, cols);
+            continue;
+        }
+        if (line == "grammar") {
+            inc.grammar().print();
+            continue;
+        }
+        if (line[0] != '+' && line[0] != '-') {
+            cout << "Start the edit with + or -.\n";
+            continue;
+        }
+        auto t0 = chrono::steady_clock::now();
+        auto rep = line[0] == '+' ? inc.addProduction(line.substr(1)) : inc.removeProduction(line.substr(1));
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        printEditReport(inc.grammar(), rep, ms);
+        cout << "Conflicting cells: " << inc.conflicts() << "\n";
+    }
+}
+
 // ----------------------------- Main -----------------------------
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(&cout);
+static void printUsage(const char *prog) {
+    cerr << "Usage:\n"
+         << "  " << prog << "                                   interactive menu\n"
+         << "  " << prog << " --batch PATH... [--threads N] [--quiet]       lex directories/files\n"
+         << "  " << prog << " --batch-list LIST... [--threads N] [--quiet]  lex paths listed in LIST\n"
+         << "  " << prog << " --lex FILE [--threads N]                     lex one large file in parallel\n"
+         << "  " << prog << " --parse FILE [--threads N]                   validate expressions, one per line\n"
+         << "  " << prog << " --parse-stream FILE|-                         validate one expression of any size\n"
+         << "  " << prog << " --check-grammar FILE                         load a grammar file and report bad lines\n"
+         << "  " << prog << " --bench [--quick] [--reps N] [--warmup N] [--seed S] [--out FILE]  benchmark every stage (JSON)\n"
+         << "  " << prog << " --gen-grammar [--nts N] [--alts N] [--len N] [--terminals N] [--left-recursion P] [--prefix P] [--seed S]\n"
+         << "  " << prog << " --gen-c [--bytes N] [--comments P] [--strings P] [--operators P] [--preprocessor P] [--seed S]\n"
+         << "Any of the above also takes --stats FILE|- for a JSON report of per-phase counters and timings.\n";
+}
+
+// Whole-string probability in [0, 1].
+static bool parseProbabilityArg(const string &s, double &out) {
+    if (s.empty() || isspace((unsigned char)s[0])) return false;
+    char *end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    if (*end || !(v >= 0.0 && v <= 1.0)) return false;
+    out = v;
+    return true;
+}
+
+static int badOptionValue(const char *prog, const string &opt, const string &value) {
+    cerr << "Invalid value for " << opt << ": '" << value << "'\n";
+    printUsage(prog);
+    return 1;
+}
+
+// Non-interactive modes; returns -1 when there are no arguments (run the menu).
+static int runCommandLine(int argc, char **argv) {
+    if (argc < 2) return -1;
+    vector<string> args(argv + 1, argv + argc);
+    string mode = args[0];
+
+    if (mode == "--batch" || mode == "--batch-list") {
+        unsigned threads = 0;
+        bool perFile = true;
+        vector<string> paths;
+        for (size_t i = 1; i < args.size(); i++) {
+            if (args[i] == "--threads" && i + 1 < args.size()) {
+                if (!parseCountArg(args[++i], threads)) return badOptionValue(argv[0], "--threads", args[i]);
+            } else if (args[i] == "--quiet") {
+                perFile = false;
+            } else {
+                paths.push_back(args[i]);
+            }
+        }
+        vector<string> files;
+        if (mode == "--batch") files = collectSourceFiles(paths);
+        else for (auto &list : paths) for (auto &f : readFileList(list)) files.push_back(f);
+        if (files.empty()) {
+            cerr << "No input files found.\n";
+            return 1;
+        }
+        runBatchLex(files, threads, perFile);
+        return 0;
+    }
+
+    if (mode == "--lex" && args.size() >= 2) {
+        unsigned threads = 0;
+        for (size_t i = 2; i + 1 < args.size(); i++)
+            if (args[i] == "--threads" && !parseCountArg(args[++i], threads))
+                return badOptionValue(argv[0], "--threads", args[i]);
+        if (threads == 0) threads = defaultThreadCount();
+        string code;
+        if (!readWholeFile(args[1], code)) {
+            cerr << "Could not open file.\n";
+            return 1;
+        }
+        auto t0 = chrono::steady_clock::now();
+        string cleaned = removeCComments(code);
+        auto t1 = chrono::steady_clock::now();
+        vector<Token> toks = tokenizeCParallel(cleaned, threads);
+        auto t2 = chrono::steady_clock::now();
+        double strip = chrono::duration<double>(t1 - t0).count(), lex = chrono::duration<double>(t2 - t1).count();
+        cout << "Input: " << code.size() << " bytes (" << cleaned.size() << " after comment removal)\n";
+        cout << "Tokens: " << toks.size() << ", lines: " << (toks.empty() ? 0 : toks.back().line) << "\n";
+        cout << "Threads: " << threads << "\n";
+        cout << fixed << setprecision(1);
+        cout << "Comment removal: " << strip * 1e3 << " ms (" << (strip > 0 ? code.size() / 1e6 / strip : 0.0) << " MB/s)\n";
+        cout << "Tokenizing: " << lex * 1e3 << " ms (" << (lex > 0 ? cleaned.size() / 1e6 / lex : 0.0) << " MB/s)\n";
+        return 0;
+    }
+
+    if (mode == "--parse" && args.size() >= 2) {
+        unsigned threads = 0;
+        for (size_t i = 2; i + 1 < args.size(); i++)
+            if (args[i] == "--threads" && !parseCountArg(args[++i], threads))
+                return badOptionValue(argv[0], "--threads", args[i]);
+        string text;
+        if (!readWholeFile(args[1], text)) {
+            cerr << "Could not open file.\n";
+            return 1;
+        }
+        Grammar g;
+        ParseTable table;
+        buildExprParser(g, table);
+        printParseRunStats(parseLinesParallel(g, table, text, threads));
+        return 0;
+    }
+
+    if (mode == "--parse-stream" && args.size() >= 2) {
+        Grammar g;
+        ParseTable table;
+        buildExprParser(g, table);
+        StreamParseResult r;
+        if (args[1] == "-") {
+            r = parseExpressionStream(g, table, cin);
+        } else {
+            ifstream fin(args[1], ios::binary);
+            if (!fin) {
+                cerr << "Could not open file.\n";
+                return 1;
+            }
+            r = parseExpressionStream(g, table, fin);
+        }
+        printStreamParseResult(r);
+        return r.status == PushParser::ACCEPTED ? 0 : 3;
+    }
+
+    if (mode == "--check-grammar" && args.size() >= 2) {
+        string text;
+        if (!readWholeFile(args[1], text)) {
+            cerr << "Could not open file.\n";
+            return 1;
+        }
+        Grammar g;
+        GrammarLoadResult res = loadGrammarText(text, g);
+        printGrammarLoadResult(res);
+        cout << "Nonterminals: " << g.nonterminals.size() << ", terminals: " << g.terminals.size() << "\n";
+        return res.errors.empty() ? 0 : 1;
+    }
+
+    if (mode == "--gen-grammar" || mode == "--gen-c") {
+        GrammarGenOptions gopt;
+        CSourceGenOptions copt;
+        for (size_t i = 1; i + 1 < args.size(); i += 2) {
+            const string &k = args[i], &v = args[i + 1];
+            bool ok = true;
+            if (k == "--seed") ok = parseCountArg(v, gopt.seed) && parseCountArg(v, copt.seed);
+            else if (k == "--nts") ok = parseCountArg(v, gopt.nonterminals);
+            else if (k == "--alts") ok = parseCountArg(v, gopt.alternatives);
+            else if (k == "--len") ok = parseCountArg(v, gopt.maxLength);
+            else if (k == "--terminals") ok = parseCountArg(v, gopt.terminals);
+            else if (k == "--left-recursion") ok = parseProbabilityArg(v, gopt.leftRecursion);
+            else if (k == "--prefix") ok = parseProbabilityArg(v, gopt.commonPrefix);
+            else if (k == "--bytes") ok = parseCountArg(v, copt.bytes);
+            else if (k == "--comments") ok = parseProbabilityArg(v, copt.comments);
+            else if (k == "--strings") ok = parseProbabilityArg(v, copt.strings);
+            else if (k == "--operators") ok = parseProbabilityArg(v, copt.operators) && copt.operators < 1.0; // 1 never ends an expression
+            else if (k == "--preprocessor") ok = parseProbabilityArg(v, copt.preprocessor);
+            else cerr << "Ignoring unknown option " << k << "\n";
+            if (!ok) return badOptionValue(argv[0], k, v);
+        }
+        cout << (mode == "--gen-grammar" ? generateGrammarText(gopt) : generateCSource(copt));
+        return 0;
+    }
+
+    if (mode == "--bench") {
+        BenchConfig cfg;
+        string outPath;
+        for (size_t i = 1; i < args.size(); i++) {
+            const string &opt = args[i];
+            if ((opt == "--reps" || opt == "--warmup" || opt == "--seed") && i + 1 < args.size()) {
+                const string &v = args[++i];
+                bool ok = opt == "--reps" ? parseCountArg(v, cfg.reps)
+                        : opt == "--warmup" ? parseCountArg(v, cfg.warmup)
+                                            : parseCountArg(v, cfg.seed);
+                if (!ok) return badOptionValue(argv[0], opt, v);
+            } else if (opt == "--quick") {
+                cfg.quick = true;
+            } else if (opt == "--out" && i + 1 < args.size()) {
+                outPath = args[++i];
+            }
+        }
+        cfg.reps = max(1, cfg.reps);
+        cerr << "Running benchmarks (" << cfg.warmup << " warm-up + " << cfg.reps << " timed runs each)\n";
+        vector<BenchResult> results = runBenchmarks(cfg);
+        if (outPath.empty()) {
+            writeBenchJson(cout, cfg, results);
+        } else {
+            ofstream out(outPath);
+            if (!out) {
+                cerr << "Could not write " << outPath << "\n";
+                return 1;
+            }
+            writeBenchJson(out, cfg, results);
+            cerr << "Wrote " << outPath << "\n";
+        }
+        return 0;
+    }
+
+    printUsage(argv[0]);
+    return 2;
+}
 
+static int runMenu() {
     while (true) {
         cout << "\n================ MINI COMPILER LAB SUITE ================\n";
         cout << "1) Case 01: Remove comments (// and /* */)\n";
@@ -1280,6 +5611,10 @@ int main() {
         cout << "5) Case 05: FIRST and FOLLOW\n";
         cout << "6) Case 06: LL(1) parsing table\n";
         cout << "7) Case 07: Predictive parser (id+id*id)\n";
+        cout << "8) Case 08: Batch lex a source tree (parallel)\n";
+        cout << "9) Case 09: Generate a standalone LL(1) parser header\n";
+        cout << "10) Case 10: LR parser (SLR(1) / LALR(1)), no grammar rewriting\n";
+        cout << "11) Case 11: Incremental grammar editing (FIRST/FOLLOW/LL(1) table)\n";
         cout << "0) Exit\n";
         cout << "Choose: ";
         cout.flush();
@@ -1295,9 +5630,48 @@ int main() {
             case 5: Case05(); break;
             case 6: Case06(); break;
             case 7: Case07(); break;
+            case 8: Case08(); break;
+            case 9: Case09(); break;
+            case 10: Case10(); break;
+            case 11: Case11(); break;
             case 0: cout << "Bye!\n"; return 0;
             default: cout << "Invalid option.\n"; break;
         }
     }
     return 0;
 }
+
+// Writes the --stats report; "-" means stdout.
+static bool writeStatsReport(const string &path) {
+    if (path == "-") {
+        writeStatsJson(cout);
+        return true;
+    }
+    ofstream out(path);
+    if (!out) {
+        cerr << "Could not write " << path << "\n";
+        return false;
+    }
+    writeStatsJson(out);
+    cerr << "Wrote " << path << "\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    ios::sync_with_stdio(false);
+    cin.tie(&cout);
+
+    // --stats FILE can go anywhere; it is taken out before the other options are read.
+    vector<char *> args{argv[0]};
+    string statsPath;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--stats" && i + 1 < argc) statsPath = argv[++i];
+        else args.push_back(argv[i]);
+    }
+    if (!statsPath.empty()) enableStats();
+
+    int rc = runCommandLine((int)args.size(), args.data());
+    if (rc < 0) rc = runMenu();
+    if (!statsPath.empty() && !writeStatsReport(statsPath) && rc == 0) rc = 1;
+    return rc;
+}